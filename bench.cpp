@@ -0,0 +1,677 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Microbenchmarks (make bench): Keccak-f[1600] permutations, the reference hash, the
+    difficulty check, the find() loop of every supported backend and, in OpenCL builds, the
+    kernel. Each case runs on pinned threads after a warm-up and reports ns/hash, cycles/hash
+    (TSC on x86) and hashes/s as JSON, optionally compared against a saved baseline. The
+    permutations, the midstate (head/digest) and the search of every supported backend are
+    first checked against the XKCP reference (exit code 3 on a mismatch); --verify only runs
+    these checks.
+*/
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utils/mining.h"
+#include "utils/json.h"
+#include "utils/topology.h"
+
+#if defined(KECCAK_X86) && !defined(_MSC_VER)
+#include <x86intrin.h>
+#endif
+
+#define GPU_NONE 0
+#define GPU_OPENCL 2
+
+#ifndef GPU
+#define GPU GPU_NONE
+#endif
+
+#if GPU == GPU_OPENCL
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+extern "C" int executeKernel(int deviceId, std::uint8_t* data, int dataSize, std::uint64_t startNonce, int nonceOffset,
+    std::uint64_t batchSize, int difficulty, int threadsPerBlock, std::uint8_t* output, std::uint64_t* validNonce, bool showDeviceInfo);
+extern "C" int executePipeline(int deviceId, std::uint8_t* data, int dataSize, int nonceOffset, int difficulty,
+    int threadsPerBlock, int depth, std::uint8_t* output, std::uint64_t* validNonce, bool showDeviceInfo,
+    bool (*nextRange)(std::uint64_t* nonce, std::uint64_t* count, void* user),
+    void (*completed)(std::uint64_t nonce, std::uint64_t count, double seconds, void* user), bool (*stopped)(void* user),
+    void* user);
+extern "C" bool selectOpenCLKernel(const char* name);
+#endif
+
+// Fixed job (block 37 of the README example); difficulty 64 is never met, so every nonce is hashed.
+static const std::uint32_t benchBlock = 37;
+static const char* benchHash = "AAAAAAn66y/43JP7M02rwTmONZoWOmu1OPYz/bmzJ8o=";
+static const char* benchMiner = "GBQHTQ7NTSKHVTSVM6EHUO3TU4P4BK2TAAII25V2TT2Q6OWXUJWEKALE";
+static const int benchDifficulty = 64;
+// Keeps results of otherwise unused computations alive.
+static volatile size_t benchSink;
+
+struct Result {
+    std::string name;
+    size_t threads;
+    double nsPerHash;
+    double cyclesPerHash;
+    double hashesPerSecond;
+};
+
+static std::uint64_t readCycles() {
+#if defined(KECCAK_X86)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Runs `work(thread, stop)` on `threads` pinned threads, once for the warm-up and once timed.
+// `work` returns the hashes it computed before `stop` was raised.
+template <typename Work>
+Result measure(const std::string& name, size_t threads, const std::vector<CpuInfo>& placement,
+    int warmupMs, int durationMs, Work work) {
+    Result result{name, threads, 0, 0, 0};
+    for (int pass = 0; pass < 2; ++pass) {
+        std::atomic<bool> stop(false);
+        std::atomic<size_t> ready(0);
+        std::atomic<std::uint64_t> hashes(0);
+        std::vector<std::thread> pool;
+        for (size_t i = 0; i < threads; ++i) {
+            pool.emplace_back([&, i]() {
+                if (!placement.empty()) {
+                    pinThread(placement[i % placement.size()].cpu);
+                }
+                ready++;
+                while (ready.load() < threads + 1) {
+                    std::this_thread::yield();
+                }
+                hashes += work(i, stop);
+            });
+        }
+        while (ready.load() < threads) {
+            std::this_thread::yield();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const std::uint64_t startCycles = readCycles();
+        ready++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(pass ? durationMs : warmupMs));
+        stop.store(true);
+        for (auto& t : pool) {
+            t.join();
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double cycles = static_cast<double>(readCycles() - startCycles);
+        if (pass && hashes.load()) {
+            result.hashesPerSecond = hashes.load() / elapsed;
+            // Per-thread cost: each thread spends `elapsed` on its share of the hashes.
+            result.nsPerHash = elapsed * 1e9 * threads / hashes.load();
+            result.cyclesPerHash = cycles * threads / hashes.load();
+        }
+    }
+    return result;
+}
+
+// Repeats `step` (one hash per call) in blocks until stopped.
+template <typename Step>
+std::uint64_t repeat(std::atomic<bool>& stop, Step step) {
+    std::uint64_t done = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < 1024; ++i) {
+            step();
+        }
+        done += 1024;
+    }
+    return done;
+}
+
+static std::vector<std::uint8_t> benchMessage() {
+    size_t nonceOffset = 0;
+    return prepare(benchBlock, 0, benchHash, benchMiner, nonceOffset);
+}
+
+// Differential check of the in-house permutations against the XKCP reference on chained
+// pseudo-random states. Returns the names of the permutations that disagree.
+static std::vector<std::string> verifyPermutations(int states) {
+    const std::pair<const char*, void (*)(std::uint8_t*)> permutations[] = {
+        {"portable", [](std::uint8_t* state) { portable_keccakF1600(state); }},
+        {"opt", [](std::uint8_t* state) { fast_keccakF1600(state); }},
+        {"lc", [](std::uint8_t* state) { lc_keccakF1600(state); }}
+    };
+    std::vector<std::string> failed;
+    for (const auto& [name, permute] : permutations) {
+        std::uint64_t seed = 0x9e3779b97f4a7c15ULL;
+        for (int i = 0; i < states; ++i) {
+            alignas(64) std::uint8_t expected[200], actual[200];
+            for (size_t byte = 0; byte < sizeof(expected); ++byte) {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                expected[byte] = static_cast<std::uint8_t>(seed >> 56);
+            }
+            // All-zero and all-one states cover the complemented lanes at their extremes.
+            if (i < 2) {
+                std::memset(expected, i ? 0xff : 0, sizeof(expected));
+            }
+            std::memcpy(actual, expected, sizeof(actual));
+            KeccakF1600(expected);
+            permute(actual);
+            if (std::memcmp(expected, actual, sizeof(actual)) != 0) {
+                failed.push_back(name);
+                break;
+            }
+        }
+    }
+    return failed;
+}
+
+template <int N>
+static std::uint64_t laneValue(const U64xN<N>& x, int i) {
+    return x.v[i];
+}
+
+// Spreads the 32 bits of x to the even bits of a lane (inverse of evenBits()).
+static std::uint64_t spreadBits(std::uint32_t x) {
+    std::uint64_t v = x;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+    v = (v | (v << 8)) & 0x00ff00ff00ff00ffULL;
+    v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    v = (v | (v << 2)) & 0x3333333333333333ULL;
+    v = (v | (v << 1)) & 0x5555555555555555ULL;
+    return v;
+}
+
+static std::uint64_t laneValue(const Lane32& x, int) {
+    return spreadBits(x.even) | (spreadBits(x.odd) << 1);
+}
+
+template <int K, typename V>
+static bool rotationMatches(const V& x, const std::uint64_t* values) {
+    const V rotated = laneRotl<K>(x);
+    for (int i = 0; i < V::width; ++i) {
+        if (laneValue(rotated, i) != ((values[i] << K) | (values[i] >> (64 - K)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename V, int... K>
+static bool rotationsMatch(const V& x, const std::uint64_t* values, std::integer_sequence<int, K...>) {
+    return (rotationMatches<K + 1>(x, values) && ...);
+}
+
+// Element-wise check of a lane type of keccakSearch<V> against uint64_t on random values: the
+// load (bit interleave for Lane32), xor, rotations 1 to 63, chi and the bit order of the
+// combined zero test.
+template <typename V>
+static bool verifyLaneType(int rounds) {
+    constexpr int width = V::width;
+    std::uint64_t seed = 0xda942042e4dd58b5ULL;
+    auto next = [&seed]() {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed ^ (seed >> 29);
+    };
+    for (int round = 0; round < rounds; ++round) {
+        std::uint64_t a[width], b[width], c[width];
+        const std::uint64_t mask = next();
+        for (int i = 0; i < width; ++i) {
+            a[i] = next();
+            b[i] = next();
+            c[i] = next();
+            // Some elements meet the mask so every hit bit pattern shows up.
+            if (next() & 1) {
+                a[i] &= ~mask;
+            }
+        }
+        const V va = V::load(a), vb = V::load(b), vc = V::load(c);
+        const V x = va ^ vb, chi = laneChi(va, vb, vc);
+        unsigned hits = 0;
+        for (int i = 0; i < width; ++i) {
+            if (laneValue(va, i) != a[i] || laneValue(x, i) != (a[i] ^ b[i]) || laneValue(chi, i) != (a[i] ^ (~b[i] & c[i]))) {
+                return false;
+            }
+            hits |= static_cast<unsigned>((a[i] & mask) == 0) << i;
+        }
+        if (laneZeros(va, V(mask)) != hits || !rotationsMatch(va, a, std::make_integer_sequence<int, 63>())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Lane types built into every binary (the SIMD ones are covered by the search differential).
+static std::vector<std::string> verifyLanes() {
+    std::vector<std::string> failed;
+    if (!verifyLaneType<U64xN<2>>(1000)) {
+        failed.push_back("multi2");
+    }
+    if (!verifyLaneType<U64xN<3>>(1000)) {
+        failed.push_back("multi3");
+    }
+    // Checked on every host, although only 32-bit ones autotune it.
+    if (!verifyLaneType<Lane32>(1000)) {
+        failed.push_back("int32");
+    }
+    return failed;
+}
+
+// Random single-block job with the nonce at `nonceOffset`, and the reference digests of the
+// nonces [start, start + count) from XKCP Keccak() on the full message.
+struct VerifyJob {
+    Keccak256Miner miner;
+    std::uint64_t start = 0;
+    std::vector<std::array<std::uint8_t, 32>> digests;
+};
+
+static VerifyJob verifyJob(std::uint64_t& seed, size_t nonceOffset, std::uint64_t count) {
+    auto next = [&seed]() {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 16;
+    };
+    std::vector<std::uint8_t> message(nonceOffset + 8 + next() % (Keccak256Miner::rate - nonceOffset - 8));
+    for (auto& byte : message) {
+        byte = static_cast<std::uint8_t>(next());
+    }
+    VerifyJob job;
+    job.miner.init(message.data(), message.size(), nonceOffset);
+    job.start = next() << 8;
+    job.digests.resize(count);
+    for (std::uint64_t i = 0; i < count; ++i) {
+        const std::uint64_t nonce = job.start + i;
+        for (int byte = 0; byte < 8; ++byte) {
+            message[nonceOffset + byte] = static_cast<std::uint8_t>(nonce >> (56 - 8 * byte));
+        }
+        Keccak(1088, 512, message.data(), message.size(), 0x01, job.digests[i].data(), 32);
+    }
+    return job;
+}
+
+// Differential check of the mining path against XKCP Keccak() on random messages, every nonce
+// offset and difficulties 0 to 8: Keccak256Miner::head() and digest() on every nonce, and the
+// nonce each supported backend reports against the first reference digest meeting the
+// difficulty, including on windows that end inside a vector (the tail mask of the SIMD and
+// multi-buffer backends). Returns the names of the checks that disagree.
+static std::vector<std::string> verifyBackends(int jobsPerOffset) {
+    const std::uint64_t count = 1024;
+    std::vector<std::string> failed;
+    auto fail = [&failed](const std::string& name) {
+        if (std::find(failed.begin(), failed.end(), name) == failed.end()) {
+            failed.push_back(name);
+        }
+    };
+    std::uint64_t seed = 0x2545f4914f6cdd1dULL;
+    for (size_t nonceOffset = 1; nonceOffset < 8; ++nonceOffset) {
+        for (int j = 0; j < jobsPerOffset; ++j) {
+            // Window sizes that are not a multiple of any backend width.
+            const VerifyJob job = verifyJob(seed, nonceOffset, count - j % 8);
+            const std::uint64_t window = job.digests.size();
+            for (std::uint64_t i = 0; i < window; ++i) {
+                std::uint8_t digest[32];
+                job.miner.digest(job.start + i, digest);
+                if (std::memcmp(digest, job.digests[i].data(), 32) != 0) {
+                    fail("digest");
+                }
+                std::uint64_t head = 0;
+                std::memcpy(&head, job.digests[i].data(), 8);
+                if (job.miner.head(job.start + i) != head) {
+                    fail("head");
+                }
+            }
+            for (int difficulty = 0; difficulty <= 8; ++difficulty) {
+                std::uint64_t first = window;
+                for (std::uint64_t i = 0; i < window && first == window; ++i) {
+                    first = zeroNibbles(job.digests[i].data()) >= difficulty ? i : window;
+                }
+                for (const auto& backend : keccakBackends()) {
+                    if (!backend.supported()) {
+                        continue;
+                    }
+                    std::uint64_t nonce = 0;
+                    const bool found = backend.search(job.miner, headMask(difficulty), job.start, window, nonce);
+                    if (found != (first < window) || (found && nonce != job.start + first)) {
+                        fail(std::string("backend/") + backend.name);
+                    }
+                    // Partial vectors: windows ending on the first hit report it in their last
+                    // lane, and the same windows one nonce shorter must mask it out.
+                    for (std::uint64_t k = 0; k <= 8 && first < window && k <= first; ++k) {
+                        const std::uint64_t from = job.start + first - k;
+                        if (!backend.search(job.miner, headMask(difficulty), from, k + 1, nonce) || nonce != job.start + first
+                            || (k > 0 && backend.search(job.miner, headMask(difficulty), from, k, nonce))) {
+                            fail(std::string("backend/") + backend.name + " (partial vector)");
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return failed;
+}
+
+std::vector<Result> runBenchmarks(const std::vector<size_t>& threadCounts, const std::vector<CpuInfo>& placement,
+    int warmupMs, int durationMs, const std::string& only) {
+    std::vector<Result> results;
+    auto run = [&](const std::string& name, auto work) {
+        if (!only.empty() && name.find(only) == std::string::npos) {
+            return;
+        }
+        for (size_t threads : threadCounts) {
+            results.push_back(measure(name, threads, placement, warmupMs, durationMs, work));
+            const Result& r = results.back();
+            std::cerr << "[BENCH] " << std::left << std::setw(22) << r.name << " threads " << std::setw(3) << r.threads
+                      << std::right << std::fixed << std::setprecision(2) << std::setw(10) << r.nsPerHash << " ns/hash "
+                      << std::setw(10) << r.cyclesPerHash << " cycles/hash " << formatHashRate(r.hashesPerSecond) << std::endl;
+        }
+    };
+
+    const std::vector<std::uint8_t> message = benchMessage();
+    const size_t maxThreads = *std::max_element(threadCounts.begin(), threadCounts.end());
+    metrics.init(std::vector<std::string>(maxThreads, "cpu"));
+    run("permutation/portable", [&](size_t, std::atomic<bool>& stop) {
+        alignas(64) std::uint8_t state[200] = {};
+        std::memcpy(state, message.data(), message.size());
+        return repeat(stop, [&]() { portable_keccakF1600(state); });
+    });
+    run("permutation/opt", [&](size_t, std::atomic<bool>& stop) {
+        alignas(64) std::uint8_t state[200] = {};
+        std::memcpy(state, message.data(), message.size());
+        return repeat(stop, [&]() { fast_keccakF1600(state); });
+    });
+    run("permutation/lc", [&](size_t, std::atomic<bool>& stop) {
+        alignas(64) std::uint8_t state[200] = {};
+        std::memcpy(state, message.data(), message.size());
+        return repeat(stop, [&]() { lc_keccakF1600(state); });
+    });
+    run("permutation/ref", [&](size_t, std::atomic<bool>& stop) {
+        alignas(64) std::uint8_t state[200] = {};
+        std::memcpy(state, message.data(), message.size());
+        return repeat(stop, [&]() { KeccakF1600(state); });
+    });
+    run("hash/ref", [&](size_t, std::atomic<bool>& stop) {
+        std::vector<std::uint8_t> input = message;
+        std::uint8_t digest[32];
+        return repeat(stop, [&]() {
+            Keccak(1088, 512, input.data(), input.size(), 0x01, digest, 32);
+            input[5] ^= digest[0];
+        });
+    });
+    run("check", [&](size_t, std::atomic<bool>& stop) {
+        // Digests with 0 to 7 leading zero nibbles, checked against difficulty 8.
+        std::vector<std::vector<std::uint8_t>> digests(64, std::vector<std::uint8_t>(32, 0xff));
+        for (size_t i = 0; i < digests.size(); ++i) {
+            std::fill(digests[i].begin(), digests[i].begin() + (i % 8) / 2, 0);
+            digests[i][(i % 8) / 2] = (i & 1) ? 0x0f : 0xff;
+        }
+        size_t i = 0, hits = 0;
+        const std::uint64_t done = repeat(stop, [&]() { hits += check(digests[i++ & 63], 8); });
+        benchSink = hits;
+        return done;
+    });
+    run("check/lane", [&](size_t, std::atomic<bool>& stop) {
+        std::vector<Digest> digests(64);
+        for (size_t i = 0; i < digests.size(); ++i) {
+            digests[i].fill(0xff);
+            std::fill(digests[i].begin(), digests[i].begin() + (i % 8) / 2, 0);
+            digests[i][(i % 8) / 2] = (i & 1) ? 0x0f : 0xff;
+        }
+        const DifficultyCheck meets = difficultyCheck(8);
+        size_t i = 0, hits = 0;
+        const std::uint64_t done = repeat(stop, [&]() { hits += meets(digests[i++ & 63].data()); });
+        benchSink = hits;
+        return done;
+    });
+    for (const auto& backend : keccakBackends()) {
+        if (!backend.supported()) {
+            continue;
+        }
+        std::shared_ptr<MiningJob> job;
+        run(std::string("find/") + backend.name, [&](size_t thread, std::atomic<bool>& stop) {
+            // The threads of a pass share one job, like the miner pool; the first thread of the
+            // next pass replaces it once stopped.
+            static std::mutex mutex;
+            std::shared_ptr<MiningJob> current;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!job || job->stop.load()) {
+                    job = makeJob(benchBlock, benchHash, 0, benchDifficulty, benchMiner, maxThreads, 1000000, 5000);
+                }
+                current = job;
+            }
+            const std::uint64_t before = metrics.hashes(thread);
+            find(thread, *current, backend, false, [&]() { return stop.load(std::memory_order_relaxed); });
+            current->stop.store(true);
+            return metrics.hashes(thread) - before;
+        });
+    }
+
+#if GPU == GPU_OPENCL
+    cl_uint platforms = 0;
+    if (clGetPlatformIDs(0, nullptr, &platforms) == CL_SUCCESS && platforms > 0
+        && (only.empty() || std::string("opencl").find(only) != std::string::npos)) {
+        std::vector<std::uint8_t> data = message;
+        std::uint8_t output[32];
+        std::uint64_t nonce = 0, found = 0;
+        const std::uint64_t batch = 1 << 20;
+        results.push_back(measure("opencl", 1, {}, warmupMs, durationMs, [&](size_t, std::atomic<bool>& stop) {
+            std::uint64_t done = 0;
+            while (!stop.load()) {
+                executeKernel(0, data.data(), static_cast<int>(data.size()), nonce, 4, batch, benchDifficulty, 256,
+                    output, &found, false);
+                nonce += batch;
+                done += batch;
+            }
+            return done;
+        }));
+        std::cerr << "[BENCH] opencl " << formatHashRate(results.back().hashesPerSecond) << std::endl;
+        struct Progress {
+            std::atomic<bool>* stop;
+            std::uint64_t batch;
+            std::uint64_t next;
+            std::uint64_t done;
+        };
+        auto pipelined = [&](const char* name, const char* kernel) {
+            selectOpenCLKernel(kernel);
+            results.push_back(measure(name, 1, {}, warmupMs, durationMs, [&](size_t, std::atomic<bool>& stop) {
+                Progress progress{&stop, batch, nonce, 0};
+                executePipeline(0, data.data(), static_cast<int>(data.size()), 4, benchDifficulty, 256, 2, output, &found, false,
+                    [](std::uint64_t* nonce, std::uint64_t* count, void* user) {
+                        auto& progress = *static_cast<Progress*>(user);
+                        *nonce = progress.next;
+                        *count = progress.batch;
+                        progress.next += progress.batch;
+                        return !progress.stop->load();
+                    },
+                    [](std::uint64_t, std::uint64_t count, double, void* user) {
+                        static_cast<Progress*>(user)->done += count;
+                    }, nullptr, &progress);
+                nonce = progress.next;
+                return progress.done;
+            }));
+            selectOpenCLKernel("generic");
+            std::cerr << "[BENCH] " << name << " " << formatHashRate(results.back().hashesPerSecond) << std::endl;
+        };
+        pipelined("opencl/pipeline", "generic");
+        pipelined("opencl/job", "job");
+        pipelined("opencl/vector", "vector");
+        pipelined("opencl/best", "best");
+    } else {
+        std::cerr << "[BENCH] opencl: no OpenCL platform, skipped" << std::endl;
+    }
+#endif
+    return results;
+}
+
+static std::string cpuModel() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0 && line.find(':') != std::string::npos) {
+            return line.substr(line.find(':') + 2);
+        }
+    }
+    return "unknown";
+}
+
+static std::string toJson(const std::vector<Result>& results) {
+    std::ostringstream out;
+    out << "{\n  \"cpu\": " << jsonQuote(cpuModel()) << ",\n  \"hardware_threads\": " << std::thread::hardware_concurrency()
+        << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "    {\"name\": " << jsonQuote(r.name) << ", \"threads\": " << r.threads << std::fixed << std::setprecision(3)
+            << ", \"ns_per_hash\": " << r.nsPerHash << ", \"cycles_per_hash\": " << r.cyclesPerHash
+            << ", \"hashes_per_second\": " << std::setprecision(0) << r.hashesPerSecond << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return out.str();
+}
+
+// Results of a previous run, keyed by "name@threads". Reads the one-result-per-line layout
+// written by toJson().
+static std::map<std::string, double> readBaseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to read baseline " + path + ".");
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t start = line.find('{');
+        const size_t end = line.rfind('}');
+        std::map<std::string, std::string> fields;
+        if (start == std::string::npos || end == std::string::npos || line.find("\"name\"") == std::string::npos
+            || !parseJsonObject(line.substr(start, end - start + 1), fields)) {
+            continue;
+        }
+        baseline[fields["name"] + "@" + fields["threads"]] = std::stod(fields["hashes_per_second"]);
+    }
+    return baseline;
+}
+
+static std::vector<size_t> parseThreads(const std::string& list) {
+    std::vector<size_t> counts;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        counts.push_back(std::max(1, std::stoi(item)));
+    }
+    return counts;
+}
+
+int main(int argc, char* argv[]) {
+    std::string baselinePath, outputPath, only;
+    double threshold = 5;
+    int warmupMs = 200, durationMs = 1000;
+    std::vector<size_t> threadCounts;
+    bool verifyOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCounts = parseThreads(argv[++i]);
+        } else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            durationMs = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmupMs = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (std::strcmp(argv[i], "--verify") == 0) {
+            verifyOnly = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--threads <n,n,...>] [--duration <ms> (default 1000)] [--warmup <ms> (default 200)]\n"
+                      << "  [--filter <name>] [--output <file>] [--baseline <file> [--threshold <percent> (default 5)]] [--verify]\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::string> mismatches;
+    for (const auto& name : verifyPermutations(1000)) {
+        mismatches.push_back("permutation/" + name);
+    }
+    for (const auto& name : verifyLanes()) {
+        mismatches.push_back("lanes/" + name);
+    }
+    for (const auto& name : verifyBackends(3)) {
+        mismatches.push_back(name);
+    }
+    for (const auto& name : mismatches) {
+        std::cerr << "[BENCH] " << name << " differs from the reference" << std::endl;
+    }
+    if (!mismatches.empty()) {
+        return 3;
+    }
+    // A backend the host cannot run is not verified; say so rather than pass silently.
+    for (const auto& backend : keccakBackends()) {
+        if (!backend.supported()) {
+            std::cerr << "[BENCH] backend/" << backend.name << " not supported on this host, not verified" << std::endl;
+        }
+    }
+    if (verifyOnly) {
+        std::cerr << "[BENCH] Permutations, midstate and backends match the reference" << std::endl;
+        return 0;
+    }
+
+    const std::vector<CpuInfo> placement = placeWorkers(readTopology(), Affinity::Core);
+    if (threadCounts.empty()) {
+        const size_t cores = placement.empty() ? std::max(1u, std::thread::hardware_concurrency()) : placement.size();
+        for (size_t n = 1; n < cores; n *= 2) {
+            threadCounts.push_back(n);
+        }
+        threadCounts.push_back(cores);
+    }
+
+    const std::vector<Result> results = runBenchmarks(threadCounts, placement, warmupMs, durationMs, only);
+    const std::string json = toJson(results);
+    if (outputPath.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream(outputPath) << json;
+    }
+
+    if (baselinePath.empty()) {
+        return 0;
+    }
+    int regressions = 0;
+    try {
+        const std::map<std::string, double> baseline = readBaseline(baselinePath);
+        for (const Result& r : results) {
+            auto it = baseline.find(r.name + "@" + std::to_string(r.threads));
+            if (it == baseline.end() || it->second <= 0) {
+                continue;
+            }
+            const double change = (r.hashesPerSecond / it->second - 1) * 100;
+            if (change < -threshold) {
+                std::cerr << "[BENCH] Regression: " << r.name << " threads " << r.threads << " " << std::fixed
+                          << std::setprecision(1) << change << "% (" << formatHashRate(r.hashesPerSecond) << " vs "
+                          << formatHashRate(it->second) << ")" << std::endl;
+                regressions++;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "[BENCH] " << regressions << " regression(s) beyond " << threshold << "%" << std::endl;
+    return regressions ? 2 : 0;
+}
@@ -11,14 +11,26 @@
 #else
 #include <CL/cl.h>
 #endif
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <cstdint>
 #include <cstring>
+#include <cstdio>
 #include <cstdlib>
 
+#include "utils/trace.h"
+#include "clsources.h"  // Generated from kernel.cl, kernel_job.cl and utils/keccak.cl (see Makefile).
+
 #define CL_CALL(call)                                                               \
     do {                                                                            \
         cl_int err = call;                                                          \
@@ -29,160 +41,740 @@
         }                                                                           \
     } while (0)
 
-void releaseResources(cl_context context, cl_command_queue commandQueue, cl_program program,
-    cl_kernel kernel, cl_mem* buffers, int bufferCount) {
-    for (int i = 0; i < bufferCount; i++) {
-        if (buffers[i]) clReleaseMemObject(buffers[i]);
+// Must match maxDataSize in kernel.cl.
+static const size_t maxDataSize = 256;
+
+static std::string deviceString(cl_device_id device, cl_device_info param) {
+    size_t size = 0;
+    if (clGetDeviceInfo(device, param, 0, nullptr, &size) != CL_SUCCESS || size == 0) {
+        return "";
     }
-    if (kernel) clReleaseKernel(kernel);
-    if (program) clReleaseProgram(program);
-    if (commandQueue) clReleaseCommandQueue(commandQueue);
-    if (context) clReleaseContext(context);
+    std::vector<char> value(size);
+    clGetDeviceInfo(device, param, size, value.data(), nullptr);
+    return std::string(value.data());
 }
 
-extern "C" int executeKernel(int deviceId, std::uint8_t* data, int dataSize, std::uint64_t startNonce, int nonceOffset, std::uint64_t batchSize,
-    int difficulty, int threadsPerBlock, std::uint8_t* output, std::uint64_t* validNonce, bool showDeviceInfo) {
-    cl_int error;
-    cl_platform_id platformId = nullptr;
-    cl_device_id selectedDevice = nullptr;
-    cl_uint numDevices;
-
-    CL_CALL(clGetPlatformIDs(1, &platformId, nullptr));
-    CL_CALL(clGetDeviceIDs(platformId, CL_DEVICE_TYPE_GPU, 0, nullptr, &numDevices));
+static std::string platformString(cl_platform_id platform, cl_platform_info param) {
+    size_t size = 0;
+    if (clGetPlatformInfo(platform, param, 0, nullptr, &size) != CL_SUCCESS || size == 0) {
+        return "";
+    }
+    std::vector<char> value(size);
+    clGetPlatformInfo(platform, param, size, value.data(), nullptr);
+    return std::string(value.data());
+}
 
-    if (deviceId >= numDevices) {
-        std::cerr << "Invalid device ID" << std::endl;
-        return -1;
+// Program binary cache: $KALE_MINER_CACHE, else the user cache directory.
+static std::filesystem::path cacheDirectory() {
+    if (const char* dir = std::getenv("KALE_MINER_CACHE")) {
+        return dir;
+    }
+#if defined(_WIN32)
+    if (const char* dir = std::getenv("LOCALAPPDATA")) {
+        return std::filesystem::path(dir) / "kale-miner";
+    }
+#else
+    if (const char* dir = std::getenv("XDG_CACHE_HOME")) {
+        return std::filesystem::path(dir) / "kale-miner";
     }
+    if (const char* dir = std::getenv("HOME")) {
+        return std::filesystem::path(dir) / ".cache" / "kale-miner";
+    }
+#endif
+    return {};
+}
 
-    std::vector<cl_device_id> devices(numDevices);
-    CL_CALL(clGetDeviceIDs(platformId, CL_DEVICE_TYPE_GPU, numDevices, devices.data(), nullptr));
-    selectedDevice = devices[deviceId];
-
-    if (showDeviceInfo) {
-        char deviceName[256];
-        char deviceVersion[256];
-        cl_uint computeUnits;
-        size_t maxWorkGroupSize;
-        size_t maxWorkItemSizes[3];
-        cl_ulong globalMemSize;
-        CL_CALL(clGetDeviceInfo(selectedDevice, CL_DEVICE_NAME, sizeof(deviceName), deviceName, nullptr));
-        CL_CALL(clGetDeviceInfo(selectedDevice, CL_DEVICE_VERSION, sizeof(deviceVersion), deviceVersion, nullptr));
-        CL_CALL(clGetDeviceInfo(selectedDevice, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(computeUnits), &computeUnits, nullptr));
-        CL_CALL(clGetDeviceInfo(selectedDevice, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(maxWorkGroupSize), &maxWorkGroupSize, nullptr));
-        CL_CALL(clGetDeviceInfo(selectedDevice, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(maxWorkItemSizes), &maxWorkItemSizes, nullptr));
-        CL_CALL(clGetDeviceInfo(selectedDevice, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMemSize), &globalMemSize, nullptr));
-        std::cout << "Device: " << deviceName << " (" << deviceVersion << ")" << std::endl;
-        std::cout << "Compute units: " << computeUnits << std::endl;
-        std::cout << "Max work group size: " << maxWorkGroupSize << std::endl;
-        std::cout << "Max work item sizes: [" 
-                    << maxWorkItemSizes[0] << ", " 
-                    << maxWorkItemSizes[1] << ", " 
-                    << maxWorkItemSizes[2] << "]" << std::endl;
-        std::cout << "Global memory size: " << (globalMemSize / (1024 * 1024)) << " MB" << std::endl;
+static std::string cacheKey(const std::string& text) {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
     }
+    static const char digits[] = "0123456789abcdef";
+    std::string key(16, '0');
+    for (int i = 15; i >= 0; --i, hash >>= 4) {
+        key[i] = digits[hash & 0xf];
+    }
+    return key;
+}
 
-    cl_context context = clCreateContext(nullptr, 1, &selectedDevice, nullptr, nullptr, &error);
-    if (!context) {
-        std::cerr << "Error: " << error << std::endl;
-        return -1;
+// Every device of every platform, GPUs first, so device 0 is the first GPU when there is one
+// and CPU runtimes such as pocl can still run (and benchmark) the kernel.
+static const std::vector<cl_device_id>& openclDevices() {
+    static const std::vector<cl_device_id> devices = []() {
+        std::vector<cl_device_id> gpus, others;
+        cl_uint platformCount = 0;
+        if (clGetPlatformIDs(0, nullptr, &platformCount) != CL_SUCCESS || platformCount == 0) {
+            return gpus;
+        }
+        std::vector<cl_platform_id> platforms(platformCount);
+        CL_CALL(clGetPlatformIDs(platformCount, platforms.data(), nullptr));
+        for (cl_platform_id platform : platforms) {
+            cl_uint count = 0;
+            if (clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 0, nullptr, &count) != CL_SUCCESS || count == 0) {
+                continue;
+            }
+            std::vector<cl_device_id> found(count);
+            CL_CALL(clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, count, found.data(), nullptr));
+            for (cl_device_id device : found) {
+                cl_device_type type = 0;
+                clGetDeviceInfo(device, CL_DEVICE_TYPE, sizeof(type), &type, nullptr);
+                ((type & CL_DEVICE_TYPE_GPU) ? gpus : others).push_back(device);
+            }
+        }
+        gpus.insert(gpus.end(), others.begin(), others.end());
+        return gpus;
+    }();
+    return devices;
+}
+
+enum class KernelVariant { Generic, Job, Best, Vector };
+static KernelVariant kernelVariant = KernelVariant::Generic;
+
+// Keccak-256 rate: messages shorter than one block can use the job kernel.
+static const int jobRate = 136;
+// Hashes between two reads of the found flag in the job kernel.
+static const int jobPollInterval = 64;
+// Work-groups of one best-of-batch launch (each has a result slot; the group id takes the low
+// 16 bits of the key in `found`) and their largest size (maxBestGroupSize in kernel.cl).
+static const size_t bestGroups = 65536;
+static const size_t maxBestGroupSize = 1024;
+
+// Build options of the job kernel (see kernel_job.cl): the padded message block as lane
+// constants with the nonce bytes zeroed, the nonce position, the difficulty and the number of
+// nonces hashed together (1, or 2/4 for runJobVector).
+static std::string jobBuildOptions(const std::uint8_t* data, int dataSize, int nonceOffset, int difficulty, int width) {
+    std::uint8_t block[jobRate] = {};
+    std::memcpy(block, data, dataSize);
+    std::memset(block + nonceOffset, 0, 8);
+    block[dataSize] ^= 0x01;
+    block[jobRate - 1] ^= 0x80;
+    std::ostringstream options;
+    options << "-D CL_TARGET_OPENCL_VERSION=" << CL_TARGET_OPENCL_VERSION;
+    for (int i = 0; i < jobRate / 8; ++i) {
+        std::uint64_t lane = 0;
+        for (int j = 7; j >= 0; --j) {
+            lane = (lane << 8) | block[i * 8 + j];
+        }
+        options << " -D M" << i << "=0x" << std::hex << lane << std::dec << "UL";
     }
+    options << " -D NONCE_LANE=" << nonceOffset / 8 << " -D NONCE_SHIFT=" << 8 * (nonceOffset % 8)
+            << " -D DIFFICULTY=" << difficulty << " -D POLL_INTERVAL=" << jobPollInterval << " -D VECTOR_WIDTH=" << width;
+    return options.str();
+}
+
+// Context, queue, kernel and buffers of one device, created on first use and kept for the
+// life of the process. Not thread-safe: one mining thread drives a device.
+class OpenCLEngine {
+    public:
+        static std::unique_ptr<OpenCLEngine> create(int deviceId) {
+            std::unique_ptr<OpenCLEngine> engine(new OpenCLEngine());
+            return engine->init(deviceId) ? std::move(engine) : nullptr;
+        }
+
+        ~OpenCLEngine() {
+            if (pinnedFound) {
+                clEnqueueUnmapMemObject(commandQueue, pinnedBuffer, pinnedFound, 0, nullptr, nullptr);
+                clFinish(commandQueue);
+            }
+            for (cl_mem buffer : {dataBuffer, foundBuffer, outputBuffer, validNonceBuffer, pinnedBuffer}) {
+                if (buffer) clReleaseMemObject(buffer);
+            }
+            if (jobKernel) clReleaseKernel(jobKernel);
+            if (jobProgram) clReleaseProgram(jobProgram);
+            if (bestKernel) clReleaseKernel(bestKernel);
+            if (kernel) clReleaseKernel(kernel);
+            if (program) clReleaseProgram(program);
+            if (cancelQueue) clReleaseCommandQueue(cancelQueue);
+            if (commandQueue) clReleaseCommandQueue(commandQueue);
+            if (context) clReleaseContext(context);
+        }
+
+        OpenCLEngine(const OpenCLEngine&) = delete;
+        OpenCLEngine& operator=(const OpenCLEngine&) = delete;
+
+        void printInfo() const {
+            cl_uint computeUnits;
+            size_t maxWorkGroupSize;
+            size_t maxWorkItemSizes[3];
+            cl_ulong globalMemSize;
+            CL_CALL(clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(computeUnits), &computeUnits, nullptr));
+            CL_CALL(clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(maxWorkGroupSize), &maxWorkGroupSize, nullptr));
+            CL_CALL(clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(maxWorkItemSizes), &maxWorkItemSizes, nullptr));
+            CL_CALL(clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMemSize), &globalMemSize, nullptr));
+            std::cout << "Device: " << deviceString(device, CL_DEVICE_NAME) << " (" << deviceString(device, CL_DEVICE_VERSION) << ")" << std::endl;
+            std::cout << "Compute units: " << computeUnits << std::endl;
+            std::cout << "Max work group size: " << maxWorkGroupSize << std::endl;
+            std::cout << "Max work item sizes: ["
+                        << maxWorkItemSizes[0] << ", "
+                        << maxWorkItemSizes[1] << ", "
+                        << maxWorkItemSizes[2] << "]" << std::endl;
+            std::cout << "Global memory size: " << (globalMemSize / (1024 * 1024)) << " MB" << std::endl;
+            std::cout << "Program: " << (cached ? "cached binary" : "built from source")
+                      << (kernelVariant == KernelVariant::Job ? ", job-specialized kernel"
+                          : kernelVariant == KernelVariant::Best ? ", best-of-batch kernel"
+                          : kernelVariant == KernelVariant::Vector ? ", job-specialized kernel on ulong" + (vectorWidth > 1 ? std::to_string(vectorWidth) : "")
+                          : "") << std::endl;
+        }
+
+        size_t workGroupLimit() const {
+            return maxWorkGroupSize;
+        }
+
+        // Runs one batch; returns 1 when a nonce was found, 0 otherwise, -1 on error.
+        int run(const std::uint8_t* data, int dataSize, std::uint64_t startNonce, int nonceOffset, std::uint64_t batchSize,
+            int difficulty, int threadsPerBlock, std::uint8_t* output, std::uint64_t* validNonce) {
+            TRACE_STEPS(trace, "buffer transfer");
+            cl_int error = prepare(data, dataSize, startNonce, nonceOffset, batchSize, difficulty, threadsPerBlock);
+            if (error != CL_SUCCESS) {
+                std::cerr << "Error: " << error << std::endl;
+                return -1;
+            }
+            TRACE_NEXT(trace, "kernel", startNonce);
+            error = clEnqueueNDRangeKernel(commandQueue, active, 1, nullptr, &globalWorkSize, &localWorkSize, 0, nullptr, nullptr);
+            if (error != CL_SUCCESS) {
+                std::cerr << "Error: " << error << std::endl;
+                return -1;
+            }
+            // In-order queue: the blocking read completes after the kernel.
+            cl_int foundValue = 0;
+            CL_CALL(clEnqueueReadBuffer(commandQueue, foundBuffer, CL_TRUE, 0, sizeof(cl_int), &foundValue, 0, nullptr, nullptr));
+            TRACE_NEXT(trace, "buffer transfer");
+            if (!solved(foundValue)) {
+                return 0;
+            }
+            readResult(foundValue, output, validNonce);
+            return 1;
+        }
+
+        // Searches the ranges handed out by `nextRange` with up to `depth` of them in flight, so
+        // the device never waits on the host. All batches share the found flag: once one finds a
+        // nonce, the queued ones exit on their first check (the best-of-batch kernel still
+        // returns the best hash of the batch that met the target). Each completed batch is
+        // reported to `completed`; once `nextRange` returns false the batches in flight are
+        // drained, unless `stopped` (optional) reports a stop: the flag is then raised from a
+        // second queue, so the running batch exits on its next poll (the best-of-batch kernel
+        // finishes it) and the queued ones on their first check, without being reported.
+        // Returns 1 when a nonce was found, 0 when stopped, -1 on error.
+        int pipeline(const std::uint8_t* data, int dataSize, int nonceOffset, int difficulty, int threadsPerBlock, int depth,
+            std::uint8_t* output, std::uint64_t* validNonce, bool (*nextRange)(std::uint64_t* nonce, std::uint64_t* count, void* user),
+            void (*completed)(std::uint64_t nonce, std::uint64_t count, double seconds, void* user), bool (*stopped)(void* user),
+            void* user) {
+            const size_t ring = static_cast<size_t>(std::max(1, depth));
+            if (!reserveSlots(ring)) {
+                return -1;
+            }
+            std::uint64_t nonce = 0, count = 0;
+            if (!nextRange(&nonce, &count, user)) {
+                return 0;
+            }
+            size_t head = 0, inFlight = 0;
+            auto enqueue = [&]() {
+                TRACE_SPAN("enqueue", nonce);
+                Slot& slot = slots[(head + inFlight) % ring];
+                const size_t globalSize = launchSize(count);
+                cl_int error = clSetKernelArg(active, nonceArg, sizeof(cl_ulong), &nonce);
+                error |= clSetKernelArg(active, batchArg, sizeof(cl_ulong), &count);
+                error |= clEnqueueNDRangeKernel(commandQueue, active, 1, nullptr, &globalSize, &localWorkSize, 0, nullptr, nullptr);
+                // Non-blocking read into pinned memory; the host only looks at it once the event completes.
+                error |= clEnqueueReadBuffer(commandQueue, foundBuffer, CL_FALSE, 0, sizeof(cl_int),
+                    &pinnedFound[(head + inFlight) % ring], 0, nullptr, &slot.done);
+                slot.nonce = nonce;
+                slot.count = count;
+                inFlight += slot.done != nullptr;
+                return error;
+            };
+            // Waits for every batch still in flight; returns whether one of them found a nonce.
+            auto drain = [&]() {
+                bool hit = false;
+                for (; inFlight; --inFlight, head = (head + 1) % ring) {
+                    clWaitForEvents(1, &slots[head].done);
+                    clReleaseEvent(slots[head].done);
+                    slots[head].done = nullptr;
+                    hit |= solved(pinnedFound[head]);
+                }
+                return hit;
+            };
+
+            cl_int error = prepare(data, dataSize, nonce, nonceOffset, count, difficulty, threadsPerBlock);
+            bool more = true;
+            if (error == CL_SUCCESS) {
+                error = enqueue();
+            }
+            while (error == CL_SUCCESS && inFlight < ring && (more = nextRange(&nonce, &count, user))) {
+                error = enqueue();
+            }
+            clFlush(commandQueue);
+            bool cancel = false;
+            auto cancelQueued = [&]() {
+                cancel = !more && stopped && stopped(user);
+                if (cancel) {
+                    clEnqueueWriteBuffer(cancelQueue, foundBuffer, CL_FALSE, 0, sizeof(cl_int),
+                        active == bestKernel ? &cancelledKey : &cancelled, 0, nullptr, nullptr);
+                    clFlush(cancelQueue);
+                }
+            };
+            cancelQueued();
+            int result = 0;
+            auto last = std::chrono::steady_clock::now();
+            while (error == CL_SUCCESS && inFlight && !cancel) {
+                Slot& slot = slots[head];
+                {
+                    TRACE_SPAN("wait", slot.nonce);
+                    error = clWaitForEvents(1, &slot.done);
+                }
+                clReleaseEvent(slot.done);
+                slot.done = nullptr;
+                const bool hit = solved(pinnedFound[head]);
+                head = (head + 1) % ring;
+                inFlight--;
+                if (error != CL_SUCCESS) {
+                    break;
+                }
+                const auto now = std::chrono::steady_clock::now();
+                completed(slot.nonce, slot.count, std::chrono::duration<double>(now - last).count(), user);
+                last = now;
+                if (hit) {
+                    result = 1;
+                    break;
+                }
+                if (more && (more = nextRange(&nonce, &count, user))) {
+                    error = enqueue();
+                    clFlush(commandQueue);
+                } else {
+                    cancelQueued();
+                }
+            }
+            result = drain() ? 1 : result;
+            if (cancel) {
+                // The next job's flag reset must not be overtaken by the cancel write.
+                clFinish(cancelQueue);
+            }
+            if (error != CL_SUCCESS) {
+                std::cerr << "Error: " << error << std::endl;
+                return -1;
+            }
+            if (result == 1) {
+                cl_int foundValue = 0;
+                CL_CALL(clEnqueueReadBuffer(commandQueue, foundBuffer, CL_TRUE, 0, sizeof(cl_int), &foundValue, 0, nullptr, nullptr));
+                readResult(foundValue, output, validNonce);
+            }
+            return result;
+        }
+
+    private:
+        struct Slot {
+            cl_event done = nullptr;
+            std::uint64_t nonce = 0;
+            std::uint64_t count = 0;
+        };
+
+        OpenCLEngine() = default;
+
+        // Whether a batch ended with `found` at or above the difficulty. The best-of-batch kernel
+        // stores (zeros << 16 | group), the others 1 on a hit (see cancelled).
+        bool solved(cl_int found) const {
+            return active == bestKernel ? (found >> 16) >= difficulty && found < cancelledKey : found == 1;
+        }
+
+        // Reads the hash and nonce of a solved batch: slot 0, or the slot of the winning group.
+        void readResult(cl_int found, std::uint8_t* output, std::uint64_t* validNonce) {
+            const size_t slot = active == bestKernel ? static_cast<size_t>(found & 0xffff) : 0;
+            CL_CALL(clEnqueueReadBuffer(commandQueue, outputBuffer, CL_TRUE, slot * 32, 32 * sizeof(cl_uchar), output, 0, nullptr, nullptr));
+            CL_CALL(clEnqueueReadBuffer(commandQueue, validNonceBuffer, CL_TRUE, slot * sizeof(cl_ulong), sizeof(cl_ulong), validNonce,
+                0, nullptr, nullptr));
+        }
+
+        // Global size of a batch of `count` nonces. The vector job kernel hashes `jobWidth` nonces
+        // per work-item; the best-of-batch kernel strides over the batch with at most
+        // `bestGroups` work-groups.
+        size_t launchSize(std::uint64_t count) const {
+            const std::uint64_t items = active == jobKernel ? (count + jobWidth - 1) / jobWidth : count;
+            const std::uint64_t groups = (items + localWorkSize - 1) / localWorkSize;
+            return static_cast<size_t>(active == bestKernel ? std::min<std::uint64_t>(groups, bestGroups) : groups) * localWorkSize;
+        }
+
+        // Pinned host memory for the per-slot copies of the found flag.
+        bool reserveSlots(size_t depth) {
+            if (slots.size() >= depth) {
+                return true;
+            }
+            if (pinnedBuffer) {
+                clEnqueueUnmapMemObject(commandQueue, pinnedBuffer, pinnedFound, 0, nullptr, nullptr);
+                clFinish(commandQueue);
+                clReleaseMemObject(pinnedBuffer);
+                pinnedFound = nullptr;
+            }
+            cl_int error;
+            pinnedBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, depth * sizeof(cl_int), nullptr, &error);
+            if (pinnedBuffer) {
+                pinnedFound = static_cast<cl_int*>(clEnqueueMapBuffer(commandQueue, pinnedBuffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                    0, depth * sizeof(cl_int), 0, nullptr, nullptr, &error));
+            }
+            if (!pinnedFound) {
+                std::cerr << "Error allocating pinned buffer: " << error << std::endl;
+                return false;
+            }
+            slots.resize(depth);
+            return true;
+        }
+
+        // Queues the job upload and found flag reset and sets the batch arguments (the start
+        // nonce is set per launch). The message only changes with the job, and the kernel writes
+        // each nonce itself, so it is uploaded only when the bytes around the nonce differ.
+        cl_int prepare(const std::uint8_t* data, int dataSize, std::uint64_t startNonce, int nonceOffset, std::uint64_t batchSize,
+            int difficulty, int threadsPerBlock) {
+            if (dataSize <= 0 || static_cast<size_t>(dataSize) > maxDataSize || nonceOffset < 0 || nonceOffset + 8 > dataSize) {
+                std::cerr << "Invalid data size." << std::endl;
+                return CL_INVALID_VALUE;
+            }
+            cl_int error = CL_SUCCESS;
+            this->difficulty = difficulty;
+            const bool specialized = kernelVariant == KernelVariant::Job || kernelVariant == KernelVariant::Vector;
+            const int width = kernelVariant == KernelVariant::Vector ? vectorWidth : 1;
+            if (specialized && dataSize < jobRate && selectJobKernel(data, dataSize, nonceOffset, difficulty, width)) {
+                active = jobKernel;
+                nonceArg = 0;
+                batchArg = 1;
+                error |= clEnqueueWriteBuffer(commandQueue, foundBuffer, CL_FALSE, 0, sizeof(cl_int), &zero, 0, nullptr, nullptr);
+                error |= clSetKernelArg(jobKernel, 0, sizeof(cl_ulong), &startNonce);
+                error |= clSetKernelArg(jobKernel, 1, sizeof(cl_ulong), &batchSize);
+                localWorkSize = std::min(static_cast<size_t>(threadsPerBlock), jobWorkGroupSize);
+                globalWorkSize = launchSize(batchSize);
+                return error;
+            }
+            active = kernelVariant == KernelVariant::Best ? bestKernel : kernel;
+            nonceArg = 1;
+            batchArg = 3;
+            const size_t nonceEnd = static_cast<size_t>(nonceOffset) + 8;
+            if (message.size() != static_cast<size_t>(dataSize) || std::memcmp(message.data(), data, nonceOffset) != 0
+                || std::memcmp(message.data() + nonceEnd, data + nonceEnd, dataSize - nonceEnd) != 0) {
+                message.assign(data, data + dataSize);
+                error |= clEnqueueWriteBuffer(commandQueue, dataBuffer, CL_FALSE, 0, message.size(), message.data(), 0, nullptr, nullptr);
+            }
+            error |= clEnqueueWriteBuffer(commandQueue, foundBuffer, CL_FALSE, 0, sizeof(cl_int), &zero, 0, nullptr, nullptr);
+            error |= clSetKernelArg(active, 0, sizeof(cl_int), &dataSize);
+            error |= clSetKernelArg(active, 1, sizeof(cl_ulong), &startNonce);
+            error |= clSetKernelArg(active, 2, sizeof(cl_int), &nonceOffset);
+            error |= clSetKernelArg(active, 3, sizeof(cl_ulong), &batchSize);
+            error |= clSetKernelArg(active, 4, sizeof(cl_int), &difficulty);
+            localWorkSize = std::min(static_cast<size_t>(threadsPerBlock), active == bestKernel ? bestWorkGroupSize : maxWorkGroupSize);
+            globalWorkSize = launchSize(batchSize);
+            return error;
+        }
+
+        // Builds the job kernel when the message, difficulty or vector width changed. A build
+        // failure keeps the generic kernel for this job.
+        bool selectJobKernel(const std::uint8_t* data, int dataSize, int nonceOffset, int difficulty, int width) {
+            const std::string options = jobBuildOptions(data, dataSize, nonceOffset, difficulty, width);
+            if (options == jobOptions) {
+                return jobKernel != nullptr;
+            }
+            TRACE_SPAN("job kernel build");
+            if (jobKernel) clReleaseKernel(jobKernel);
+            if (jobProgram) clReleaseProgram(jobProgram);
+            jobKernel = nullptr;
+            jobOptions = options;
+            jobWidth = width;
+            jobProgram = buildSource(jobKernelSource, options);
+            if (!jobProgram) {
+                std::cerr << "Job kernel build failed, using the generic kernel." << std::endl;
+                return false;
+            }
+            cl_int error;
+            jobKernel = clCreateKernel(jobProgram, width > 1 ? "runJobVector" : "runJob", &error);
+            if (jobKernel) {
+                error = clSetKernelArg(jobKernel, 2, sizeof(cl_mem), &foundBuffer);
+                error |= clSetKernelArg(jobKernel, 3, sizeof(cl_mem), &outputBuffer);
+                error |= clSetKernelArg(jobKernel, 4, sizeof(cl_mem), &validNonceBuffer);
+                clGetKernelWorkGroupInfo(jobKernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &jobWorkGroupSize, nullptr);
+            }
+            if (!jobKernel || error != CL_SUCCESS) {
+                std::cerr << "Error: " << error << std::endl;
+                if (jobKernel) clReleaseKernel(jobKernel);
+                jobKernel = nullptr;
+                return false;
+            }
+            return true;
+        }
+
+        bool init(int deviceId) {
+            cl_int error;
+            TRACE_STEPS(trace, "device setup");
+            const std::vector<cl_device_id>& devices = openclDevices();
+            if (deviceId < 0 || static_cast<size_t>(deviceId) >= devices.size()) {
+                std::cerr << "Invalid device ID" << std::endl;
+                return false;
+            }
+            device = devices[deviceId];
+            cl_platform_id platformId = nullptr;
+            CL_CALL(clGetDeviceInfo(device, CL_DEVICE_PLATFORM, sizeof(platformId), &platformId, nullptr));
+            cl_uint preferredWidth = 1;
+            clGetDeviceInfo(device, CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG, sizeof(preferredWidth), &preferredWidth, nullptr);
+            vectorWidth = preferredWidth >= 4 ? 4 : preferredWidth >= 2 ? 2 : 1;
+
+            context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &error);
+            if (!context) {
+                std::cerr << "Error: " << error << std::endl;
+                return false;
+            }
 #if CL_TARGET_OPENCL_VERSION >= 200
-    cl_command_queue commandQueue = clCreateCommandQueueWithProperties(context, selectedDevice, 0, &error);
+            commandQueue = clCreateCommandQueueWithProperties(context, device, 0, &error);
+            cancelQueue = commandQueue ? clCreateCommandQueueWithProperties(context, device, 0, &error) : nullptr;
 #else
-    cl_command_queue commandQueue = clCreateCommandQueue(context, selectedDevice, 0, &error);
+            commandQueue = clCreateCommandQueue(context, device, 0, &error);
+            cancelQueue = commandQueue ? clCreateCommandQueue(context, device, 0, &error) : nullptr;
 #endif
-    if (!commandQueue) {
-        std::cerr << "Error: " << error << std::endl;
-        releaseResources(context, commandQueue, nullptr, nullptr, nullptr, 0);
-        return -1;
-    }
+            if (!commandQueue || !cancelQueue) {
+                std::cerr << "Error: " << error << std::endl;
+                return false;
+            }
 
-    std::ifstream kernelFile("kernel.cl");
-    std::ifstream keccakFile("utils/keccak.cl");
-    if (!kernelFile.is_open() || !keccakFile.is_open()) {
-        std::cerr << "Failed to load OpenCL kernel files." << std::endl;
-        releaseResources(context, commandQueue, nullptr, nullptr, nullptr, 0);
-        return -1;
-    }
-    std::string kernelSource((std::istreambuf_iterator<char>(kernelFile)), std::istreambuf_iterator<char>());
-    std::string keccakSource((std::istreambuf_iterator<char>(keccakFile)), std::istreambuf_iterator<char>());
-    kernelFile.close();
-    keccakFile.close();
-    std::string fullSource = keccakSource + "\n" + kernelSource;
-    const char* sourceStr = fullSource.c_str();
-    size_t sourceSize = fullSource.size();
-
-    cl_program program = clCreateProgramWithSource(context, 1, &sourceStr, &sourceSize, &error);
-    if (!program) {
-        std::cerr << "Error: " << error << std::endl;
-        releaseResources(context, commandQueue, program, nullptr, nullptr, 0);
-        return -1;
+            TRACE_NEXT(trace, "kernel build");
+            const std::string source = std::string(keccakSource) + "\n" + kernelSource;
+            const std::string buildOptions = "-D CL_TARGET_OPENCL_VERSION=" + std::to_string(CL_TARGET_OPENCL_VERSION);
+            const std::string key = cacheKey(platformString(platformId, CL_PLATFORM_NAME) + "\n"
+                + platformString(platformId, CL_PLATFORM_VERSION) + "\n" + deviceString(device, CL_DEVICE_NAME) + "\n"
+                + deviceString(device, CL_DEVICE_VERSION) + "\n" + deviceString(device, CL_DRIVER_VERSION) + "\n"
+                + buildOptions + "\n" + source);
+            const std::filesystem::path directory = cacheDirectory();
+            const std::filesystem::path cachePath = directory.empty() ? directory : directory / ("kernel-" + key + ".bin");
+            cached = !cachePath.empty() && loadBinary(cachePath, buildOptions);
+            if (!cached) {
+                program = buildSource(source, buildOptions);
+                if (!program) {
+                    return false;
+                }
+                if (!cachePath.empty()) {
+                    storeBinary(cachePath);
+                }
+            }
+            kernel = clCreateKernel(program, "run", &error);
+            if (!kernel || error != CL_SUCCESS) {
+                std::cerr << "Error: " << error << std::endl;
+                return false;
+            }
+            clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkGroupSize, nullptr);
+            bestKernel = clCreateKernel(program, "runBest", &error);
+            if (!bestKernel || error != CL_SUCCESS) {
+                std::cerr << "Error: " << error << std::endl;
+                return false;
+            }
+            clGetKernelWorkGroupInfo(bestKernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &bestWorkGroupSize, nullptr);
+            bestWorkGroupSize = std::min(bestWorkGroupSize, maxBestGroupSize);
+
+            TRACE_NEXT(trace, "buffer allocation");
+            dataBuffer = clCreateBuffer(context, CL_MEM_READ_ONLY, maxDataSize * sizeof(cl_uchar), nullptr, &error);
+            foundBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int), nullptr, &error);
+            // One result slot per work-group of the best-of-batch kernel; the others use slot 0.
+            outputBuffer = clCreateBuffer(context, CL_MEM_WRITE_ONLY, bestGroups * 32 * sizeof(cl_uchar), nullptr, &error);
+            validNonceBuffer = clCreateBuffer(context, CL_MEM_WRITE_ONLY, bestGroups * sizeof(cl_ulong), nullptr, &error);
+            if (!dataBuffer || !foundBuffer || !outputBuffer || !validNonceBuffer) {
+                std::cerr << "Error allocating buffer." << std::endl;
+                return false;
+            }
+            error = CL_SUCCESS;
+            for (cl_kernel searchKernel : {kernel, bestKernel}) {
+                error |= clSetKernelArg(searchKernel, 5, sizeof(cl_mem), &dataBuffer);
+                error |= clSetKernelArg(searchKernel, 6, sizeof(cl_mem), &foundBuffer);
+                error |= clSetKernelArg(searchKernel, 7, sizeof(cl_mem), &outputBuffer);
+                error |= clSetKernelArg(searchKernel, 8, sizeof(cl_mem), &validNonceBuffer);
+            }
+            if (error != CL_SUCCESS) {
+                std::cerr << "Error: " << error << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        cl_program buildSource(const std::string& source, const std::string& buildOptions) {
+            cl_int error;
+            const char* sourceStr = source.c_str();
+            size_t sourceSize = source.size();
+            cl_program built = clCreateProgramWithSource(context, 1, &sourceStr, &sourceSize, &error);
+            if (!built) {
+                std::cerr << "Error: " << error << std::endl;
+                return nullptr;
+            }
+            error = clBuildProgram(built, 1, &device, buildOptions.c_str(), nullptr, nullptr);
+            if (error != CL_SUCCESS) {
+                size_t logSize;
+                clGetProgramBuildInfo(built, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &logSize);
+                std::vector<char> buildLog(logSize);
+                clGetProgramBuildInfo(built, device, CL_PROGRAM_BUILD_LOG, logSize, buildLog.data(), NULL);
+                std::cerr << "Kernel build error: " << std::endl << buildLog.data() << std::endl;
+                clReleaseProgram(built);
+                return nullptr;
+            }
+            return built;
+        }
+
+        // A missing, stale or rejected binary falls back to the source build.
+        bool loadBinary(const std::filesystem::path& path, const std::string& buildOptions) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                return false;
+            }
+            std::vector<unsigned char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (binary.empty()) {
+                return false;
+            }
+            const unsigned char* binaryPtr = binary.data();
+            const size_t binarySize = binary.size();
+            cl_int status = CL_SUCCESS, error = CL_SUCCESS;
+            program = clCreateProgramWithBinary(context, 1, &device, &binarySize, &binaryPtr, &status, &error);
+            if (program && (error != CL_SUCCESS || status != CL_SUCCESS
+                || clBuildProgram(program, 1, &device, buildOptions.c_str(), nullptr, nullptr) != CL_SUCCESS)) {
+                clReleaseProgram(program);
+                program = nullptr;
+            }
+            return program != nullptr;
+        }
+
+        // Best effort: written to a temporary file and renamed so readers never see a partial binary.
+        void storeBinary(const std::filesystem::path& path) {
+            size_t binarySize = 0;
+            if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &binarySize, nullptr) != CL_SUCCESS
+                || binarySize == 0) {
+                return;
+            }
+            std::vector<unsigned char> binary(binarySize);
+            unsigned char* binaryPtr = binary.data();
+            if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binaryPtr), &binaryPtr, nullptr) != CL_SUCCESS) {
+                return;
+            }
+            std::error_code error;
+            std::filesystem::create_directories(path.parent_path(), error);
+            std::filesystem::path temp = path;
+            temp += ".tmp";
+            {
+                std::ofstream file(temp, std::ios::binary);
+                file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+                if (!file) {
+                    return;
+                }
+            }
+            std::filesystem::rename(temp, path, error);
+        }
+
+        cl_device_id device = nullptr;
+        cl_context context = nullptr;
+        cl_command_queue commandQueue = nullptr;
+        // Second queue for the cancel write, which must not wait behind the queued batches.
+        cl_command_queue cancelQueue = nullptr;
+        cl_program program = nullptr;
+        cl_kernel kernel = nullptr;
+        cl_kernel bestKernel = nullptr;
+        size_t bestWorkGroupSize = 1;
+        // Kernel launched by run()/pipeline() and the indexes of its start nonce and batch size arguments.
+        cl_kernel active = nullptr;
+        cl_uint nonceArg = 1;
+        cl_uint batchArg = 3;
+        // Difficulty of the current job, for the best-of-batch results.
+        int difficulty = 0;
+        cl_program jobProgram = nullptr;
+        cl_kernel jobKernel = nullptr;
+        std::string jobOptions;
+        size_t jobWorkGroupSize = 1;
+        // Nonces per work-item of the job kernel, and the width --cl-kernel vector builds it with
+        // (from CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG; 1 is the scalar runJob).
+        int jobWidth = 1;
+        int vectorWidth = 1;
+        cl_mem dataBuffer = nullptr;
+        cl_mem foundBuffer = nullptr;
+        cl_mem outputBuffer = nullptr;
+        cl_mem validNonceBuffer = nullptr;
+        size_t maxWorkGroupSize = 1;
+        size_t localWorkSize = 1;
+        size_t globalWorkSize = 0;
+        std::vector<Slot> slots;
+        cl_mem pinnedBuffer = nullptr;
+        cl_int* pinnedFound = nullptr;
+        bool cached = false;
+        std::vector<std::uint8_t> message;
+        const cl_int zero = 0;
+        // Found flag values that stop every batch but are not a result: the generic and job
+        // kernels exit on any non-zero flag, the best-of-batch kernel once the key reaches the
+        // difficulty (no digest has 65 leading zero nibbles).
+        const cl_int cancelled = 2;
+        const cl_int cancelledKey = 65 << 16;
+};
+
+static OpenCLEngine* engineFor(int deviceId, bool showDeviceInfo) {
+    static std::mutex mutex;
+    static std::map<int, std::unique_ptr<OpenCLEngine>> engines;
+    OpenCLEngine* engine = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<OpenCLEngine>& slot = engines[deviceId];
+        if (!slot) {
+            slot = OpenCLEngine::create(deviceId);
+        }
+        engine = slot.get();
     }
-    std::string buildOptions = "-D CL_TARGET_OPENCL_VERSION=" + std::to_string(CL_TARGET_OPENCL_VERSION);
-    error = clBuildProgram(program, 1, &selectedDevice, buildOptions.c_str(), nullptr, nullptr);
-    if (error != CL_SUCCESS) {
-        size_t logSize;
-        clGetProgramBuildInfo(program, selectedDevice, CL_PROGRAM_BUILD_LOG, 0, NULL, &logSize);
-        std::vector<char> buildLog(logSize);
-        clGetProgramBuildInfo(program, selectedDevice, CL_PROGRAM_BUILD_LOG, logSize, buildLog.data(), NULL);
-        std::cerr << "Kernel build error: " << std::endl << buildLog.data() << std::endl;
-        releaseResources(context, commandQueue, program, nullptr, nullptr, 0);
-        return -1;
+    if (engine && showDeviceInfo) {
+        engine->printInfo();
     }
-    cl_kernel kernel = clCreateKernel(program, "run", &error);
-    if (!kernel || error != CL_SUCCESS) {
-        std::cerr << "Error: " << error << std::endl;
-        releaseResources(context, commandQueue, program, kernel, nullptr, 0);
+    return engine;
+}
+
+extern "C" int executeKernel(int deviceId, std::uint8_t* data, int dataSize, std::uint64_t startNonce, int nonceOffset, std::uint64_t batchSize,
+    int difficulty, int threadsPerBlock, std::uint8_t* output, std::uint64_t* validNonce, bool showDeviceInfo) {
+    OpenCLEngine* engine = engineFor(deviceId, showDeviceInfo);
+    if (!engine) {
         return -1;
     }
+    return engine->run(data, dataSize, startNonce, nonceOffset, batchSize, difficulty, threadsPerBlock, output, validNonce);
+}
 
-    cl_mem deviceDataBuffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, dataSize * sizeof(cl_uchar), data, &error);
-    cl_mem foundBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int), nullptr, &error);
-    cl_mem outputBuffer = clCreateBuffer(context, CL_MEM_WRITE_ONLY, 32 * sizeof(cl_uchar), nullptr, &error);
-    cl_mem validNonceBuffer = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_ulong), nullptr, &error);
-    cl_mem buffers[] = {deviceDataBuffer, foundBuffer, outputBuffer, validNonceBuffer};
-    for (auto& buf : buffers) {
-        if (!buf) {
-            std::cerr << "Error allocating buffer." << std::endl;
-            releaseResources(context, commandQueue, program, kernel, buffers, 4);
-            return -1;
-        }
-    }
-    cl_int foundValue = 0;
-    error = clEnqueueWriteBuffer(commandQueue, foundBuffer, CL_TRUE, 0, sizeof(cl_int), &foundValue, 0, nullptr, nullptr);
-    error |= clSetKernelArg(kernel, 0, sizeof(cl_int), &dataSize);
-    error |= clSetKernelArg(kernel, 1, sizeof(cl_ulong), &startNonce);
-    error |= clSetKernelArg(kernel, 2, sizeof(cl_int), &nonceOffset);
-    error |= clSetKernelArg(kernel, 3, sizeof(cl_ulong), &batchSize);
-    error |= clSetKernelArg(kernel, 4, sizeof(cl_int), &difficulty);
-    error |= clSetKernelArg(kernel, 5, sizeof(cl_mem), &deviceDataBuffer);
-    error |= clSetKernelArg(kernel, 6, sizeof(cl_mem), &foundBuffer);
-    error |= clSetKernelArg(kernel, 7, sizeof(cl_mem), &outputBuffer);
-    error |= clSetKernelArg(kernel, 8, sizeof(cl_mem), &validNonceBuffer);
-    if (error != CL_SUCCESS) {
-        std::cerr << "Error: " << error << std::endl;
-        releaseResources(context, commandQueue, program, kernel, buffers, 4);
+// Pipelined search over the ranges returned by `nextRange` (see OpenCLEngine::pipeline).
+extern "C" int executePipeline(int deviceId, std::uint8_t* data, int dataSize, int nonceOffset, int difficulty,
+    int threadsPerBlock, int depth, std::uint8_t* output, std::uint64_t* validNonce, bool showDeviceInfo,
+    bool (*nextRange)(std::uint64_t* nonce, std::uint64_t* count, void* user),
+    void (*completed)(std::uint64_t nonce, std::uint64_t count, double seconds, void* user), bool (*stopped)(void* user),
+    void* user) {
+    OpenCLEngine* engine = engineFor(deviceId, showDeviceInfo);
+    if (!engine) {
         return -1;
     }
+    return engine->pipeline(data, dataSize, nonceOffset, difficulty, threadsPerBlock, depth, output, validNonce,
+        nextRange, completed, stopped, user);
+}
 
-    size_t maxWorkGroupSize;
-    clGetDeviceInfo(selectedDevice, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkGroupSize, NULL);
-    size_t localWorkSize = std::min(static_cast<size_t>(threadsPerBlock), maxWorkGroupSize);
-    size_t globalWorkSize = ((batchSize + localWorkSize - 1) / localWorkSize) * localWorkSize;
-    error = clEnqueueNDRangeKernel(commandQueue, kernel, 1, nullptr, &globalWorkSize, &localWorkSize, 0, nullptr, nullptr);
-    if (error != CL_SUCCESS) {
-        std::cerr << "Error: " << error << std::endl;
-        releaseResources(context, commandQueue, program, kernel, buffers, 4);
-        return -1;
+// Selects the OpenCL kernel of the following batches: "generic", "job" (compiled per job with
+// the message and difficulty as constants), "vector" (the job kernel on ulong2/ulong4 states,
+// as wide as the device prefers) or "best" (best hash of each batch, see runBest in kernel.cl).
+// Returns false for an unknown name.
+extern "C" bool selectOpenCLKernel(const char* name) {
+    if (std::strcmp(name, "generic") == 0) {
+        kernelVariant = KernelVariant::Generic;
+    } else if (std::strcmp(name, "job") == 0) {
+        kernelVariant = KernelVariant::Job;
+    } else if (std::strcmp(name, "vector") == 0) {
+        kernelVariant = KernelVariant::Vector;
+    } else if (std::strcmp(name, "best") == 0) {
+        kernelVariant = KernelVariant::Best;
+    } else {
+        return false;
     }
+    return true;
+}
+
+extern "C" int openclDeviceCount() {
+    return static_cast<int>(openclDevices().size());
+}
 
-    clFinish(commandQueue);
-    CL_CALL(clEnqueueReadBuffer(commandQueue, foundBuffer, CL_TRUE, 0, sizeof(cl_int), &foundValue, 0, nullptr, nullptr));
-    if (foundValue == 1) {
-        CL_CALL(clEnqueueReadBuffer(commandQueue, outputBuffer, CL_TRUE, 0, 32 * sizeof(cl_uchar), output, 0, nullptr, nullptr));
-        CL_CALL(clEnqueueReadBuffer(commandQueue, validNonceBuffer, CL_TRUE, 0, sizeof(cl_ulong), validNonce, 0, nullptr, nullptr));
+// Writes the name of device `deviceId` (NUL-terminated, truncated to `size`).
+extern "C" bool openclDeviceName(int deviceId, char* name, size_t size) {
+    const std::vector<cl_device_id>& devices = openclDevices();
+    if (deviceId < 0 || static_cast<size_t>(deviceId) >= devices.size() || size == 0) {
+        return false;
     }
-    releaseResources(context, commandQueue, program, kernel, buffers, 4);
-    return foundValue;
+    std::snprintf(name, size, "%s", deviceString(devices[deviceId], CL_DEVICE_NAME).c_str());
+    return true;
+}
+
+// Largest work-group size the kernel accepts on device `deviceId` (0 when unavailable).
+extern "C" int openclWorkGroupLimit(int deviceId) {
+    OpenCLEngine* engine = engineFor(deviceId, false);
+    return engine ? static_cast<int>(engine->workGroupLimit()) : 0;
 }
@@ -72,7 +72,8 @@ async function work(mining, key, blockData, onStart) {
         verbose,
         device,
         executable,
-        continuous
+        continuous,
+        inProcess
     } = config.miner;
 
     if (mining && (!signers[key].work || continuous)) {
@@ -80,8 +81,11 @@ async function work(mining, key, blockData, onStart) {
             const workDiff = signers[key].work?.difficulty ? signers[key].work.difficulty + 1 : 0;
             const workNonce = signers[key].work?.nonce ? signers[key].work.nonce + 1 : 0;
             const diff = workDiff || (await strategy.difficulty(key, deepCopy(blockData))) || signers[key].difficulty || difficulty || 6;
-            const { work } = await mine(executable, blockData.block, blockData.hash, workNonce || nonce,
-                diff, key, maxThreads, batchSize, device, gpu, verbose, onStart);
+            const engine = inProcess && !gpu ? nativeEngine(maxThreads) : null;
+            const { work } = engine
+                ? await mineInProcess(engine, blockData.block, blockData.hash, workNonce || nonce, diff, key, verbose, onStart)
+                : await mine(executable, blockData.block, blockData.hash, workNonce || nonce,
+                    diff, key, maxThreads, batchSize, device, gpu, verbose, onStart);
             signers[key].work = { ...work, difficulty: diff };
             signers[key].stats.lastDiff = diff;
             signers[key].stats.minDiff = Math.min(signers[key].stats.minDiff || Number.MAX_VALUE, diff);
@@ -183,6 +187,82 @@ async function mine(minerExec, block, hash, nonce, difficulty, key, maxThreads,
     });
 }
 
+// In-process engine (libkaleminer addon), created on first use; null when the addon is not built.
+let engineInstance;
+function nativeEngine(maxThreads) {
+    if (engineInstance === undefined) {
+        try {
+            const { Engine } = require('./native');
+            engineInstance = new Engine({ threads: maxThreads });
+        } catch (error) {
+            console.error(`In-process miner unavailable (${error.message}), spawning the miner instead`);
+            engineInstance = null;
+        }
+    }
+    return engineInstance;
+}
+
+function formatHashRate(rate) {
+    const units = ['H/s', 'KH/s', 'MH/s', 'GH/s', 'TH/s', 'PH/s', 'EH/s'];
+    let unit = 0;
+    while (rate >= 1000 && unit < units.length - 1) {
+        rate /= 1000;
+        unit++;
+    }
+    return `${rate.toFixed(2)} ${units[unit]}`;
+}
+
+// Same contract as mine(): onStart receives a handle whose kill() cancels the job.
+async function mineInProcess(engine, block, hash, nonce, difficulty, key, verbose, onStart = null) {
+    return new Promise((resolve, reject) => {
+        session.gpu = false;
+        console.log(`Farmer ${key} in-process job started: ${[block, hash, nonce, difficulty]}\n====MINING JOB=====\n`);
+        let job, done = false;
+        const finish = (status) => {
+            if (done) {
+                return;
+            }
+            done = true;
+            engine.onStatus(null);
+            console.log(`====END MINING JOB=====\nFarmer ${key} in-process job ${status.state}`);
+            if (status.state === 'solved') {
+                resolve({ work: { hash: status.hash, nonce: status.nonce } });
+            } else {
+                reject(new Error(`No result found`));
+            }
+        };
+        engine.onStatus((status) => {
+            if (status.job !== job) {
+                return;
+            }
+            session.hashrate = formatHashRate(status.hashRate);
+            if (status.state === 'mining') {
+                if (verbose) {
+                    console.log(`[CPU] Hash Rate: ${session.hashrate}`);
+                }
+            } else {
+                finish(status);
+            }
+        }, 5000);
+        try {
+            job = engine.submit({ block, hash, nonce, difficulty, miner: key });
+        } catch (error) {
+            engine.onStatus(null);
+            reject(error);
+            return;
+        }
+        if (typeof onStart === 'function') {
+            onStart({
+                kill: () => {
+                    if (engine.cancel(job)) {
+                        finish(engine.status());
+                    }
+                }
+            });
+        }
+    });
+}
+
 async function runFarm(interval) {
     session.time = Date.now();
     const asyncHarvest = StrKey.isValidEd25519SecretSeed(config.harvester?.account);
@@ -0,0 +1,11 @@
+{
+  "targets": [
+    {
+      "target_name": "kaleminer",
+      "sources": ["kaleminer_addon.cc"],
+      "include_dirs": ["../.."],
+      "libraries": ["-L<(module_root_dir)/../..", "-lkaleminer", "-Wl,-rpath,<(module_root_dir)/../.."],
+      "cflags_cc": ["-std=c++17"]
+    }
+  ]
+}
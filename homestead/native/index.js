@@ -0,0 +1,8 @@
+/*!
+ * This file is part of kale-miner.
+ * Author: Fred Kyung-jin Rezeau <fred@litemint.com>
+ */
+
+// In-process miner (libkaleminer). Build with `make lib` at the repository root, then
+// `npm run native` in homestead.
+module.exports = require('./build/Release/kaleminer.node');
@@ -0,0 +1,299 @@
+/*!
+ * This file is part of kale-miner.
+ * Author: Fred Kyung-jin Rezeau <fred@litemint.com>
+ *
+ * N-API binding of libkaleminer (kaleminer.h), so homestead mines in-process.
+ */
+
+#include <node_api.h>
+
+#include <cstdio>
+#include <string>
+
+#include "kaleminer.h"
+
+namespace {
+
+struct Engine {
+    kale_engine* engine = nullptr;
+    // Delivers kale_status copies from the engine threads to the JS status callback.
+    napi_threadsafe_function onStatus = nullptr;
+};
+
+const char* stateName(int state) {
+    switch (state) {
+        case KALE_MINING: return "mining";
+        case KALE_SOLVED: return "solved";
+        case KALE_CANCELLED: return "cancelled";
+        default: return "idle";
+    }
+}
+
+napi_value fail(napi_env env, const char* message) {
+    napi_throw_error(env, nullptr, message);
+    return nullptr;
+}
+
+void setNumber(napi_env env, napi_value object, const char* name, double value) {
+    napi_value number;
+    napi_create_double(env, value, &number);
+    napi_set_named_property(env, object, name, number);
+}
+
+void setString(napi_env env, napi_value object, const char* name, const std::string& value) {
+    napi_value string;
+    napi_create_string_utf8(env, value.c_str(), value.size(), &string);
+    napi_set_named_property(env, object, name, string);
+}
+
+napi_value toObject(napi_env env, const kale_status& status) {
+    napi_value object;
+    napi_create_object(env, &object);
+    setNumber(env, object, "job", static_cast<double>(status.job));
+    setString(env, object, "state", stateName(status.state));
+    setNumber(env, object, "hashes", static_cast<double>(status.hashes));
+    setNumber(env, object, "hashRate", status.hash_rate);
+    setNumber(env, object, "elapsed", status.elapsed);
+    if (status.state == KALE_SOLVED) {
+        std::string hex;
+        char byte[3];
+        for (unsigned char value : status.hash) {
+            std::snprintf(byte, sizeof(byte), "%02x", value);
+            hex += byte;
+        }
+        setNumber(env, object, "nonce", static_cast<double>(status.nonce));
+        setString(env, object, "hash", hex);
+        setNumber(env, object, "zeros", status.zeros);
+    }
+    return object;
+}
+
+void callStatus(napi_env env, napi_value callback, void*, void* data) {
+    kale_status* status = static_cast<kale_status*>(data);
+    if (env && callback) {
+        napi_value global, argument = toObject(env, *status);
+        napi_get_global(env, &global);
+        napi_call_function(env, global, callback, 1, &argument, nullptr);
+    }
+    delete status;
+}
+
+void deliverStatus(const kale_status* status, void* user) {
+    kale_status* copy = new kale_status(*status);
+    if (napi_call_threadsafe_function(static_cast<napi_threadsafe_function>(user), copy, napi_tsfn_nonblocking) != napi_ok) {
+        delete copy;
+    }
+}
+
+// Stops the callbacks before releasing the threadsafe function they use.
+void clearStatus(Engine* self) {
+    if (self->engine) {
+        kale_set_callback(self->engine, nullptr, nullptr, 0);
+    }
+    if (self->onStatus) {
+        napi_release_threadsafe_function(self->onStatus, napi_tsfn_release);
+        self->onStatus = nullptr;
+    }
+}
+
+void close(Engine* self) {
+    clearStatus(self);
+    if (self->engine) {
+        kale_engine_destroy(self->engine);
+        self->engine = nullptr;
+    }
+}
+
+Engine* unwrap(napi_env env, napi_callback_info info, size_t& argc, napi_value* argv) {
+    napi_value thisArg;
+    void* self = nullptr;
+    napi_get_cb_info(env, info, &argc, argv, &thisArg, nullptr);
+    napi_unwrap(env, thisArg, &self);
+    if (!self || !static_cast<Engine*>(self)->engine) {
+        fail(env, "Engine is closed.");
+        return nullptr;
+    }
+    return static_cast<Engine*>(self);
+}
+
+bool property(napi_env env, napi_value object, const char* name, napi_value& value) {
+    bool has = false;
+    napi_valuetype type = napi_undefined;
+    if (napi_has_named_property(env, object, name, &has) != napi_ok || !has) {
+        return false;
+    }
+    napi_get_named_property(env, object, name, &value);
+    napi_typeof(env, value, &type);
+    return type != napi_undefined && type != napi_null;
+}
+
+std::string stringProperty(napi_env env, napi_value object, const char* name) {
+    napi_value value;
+    size_t length = 0;
+    if (!property(env, object, name, value) || napi_get_value_string_utf8(env, value, nullptr, 0, &length) != napi_ok) {
+        return "";
+    }
+    std::string result(length, '\0');
+    napi_get_value_string_utf8(env, value, &result[0], length + 1, &length);
+    return result;
+}
+
+// Numbers or BigInts (nonces beyond 2^53).
+bool integerProperty(napi_env env, napi_value object, const char* name, uint64_t& result) {
+    napi_value value;
+    napi_valuetype type;
+    if (!property(env, object, name, value)) {
+        return false;
+    }
+    napi_typeof(env, value, &type);
+    if (type == napi_bigint) {
+        bool lossless = false;
+        return napi_get_value_bigint_uint64(env, value, &result, &lossless) == napi_ok && lossless;
+    }
+    int64_t number = 0;
+    if (napi_get_value_int64(env, value, &number) != napi_ok || number < 0) {
+        return false;
+    }
+    result = static_cast<uint64_t>(number);
+    return true;
+}
+
+// new Engine({ threads, keccak, affinity })
+napi_value construct(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1], thisArg;
+    napi_get_cb_info(env, info, &argc, argv, &thisArg, nullptr);
+    uint64_t threads = 0;
+    std::string keccak, affinity;
+    if (argc > 0) {
+        integerProperty(env, argv[0], "threads", threads);
+        keccak = stringProperty(env, argv[0], "keccak");
+        affinity = stringProperty(env, argv[0], "affinity");
+    }
+    Engine* self = new Engine();
+    self->engine = kale_engine_create(static_cast<int>(threads), keccak.empty() ? nullptr : keccak.c_str(),
+        affinity.empty() ? nullptr : affinity.c_str());
+    if (!self->engine) {
+        delete self;
+        return fail(env, kale_last_error());
+    }
+    napi_wrap(env, thisArg, self, [](napi_env, void* data, void*) {
+        Engine* self = static_cast<Engine*>(data);
+        close(self);
+        delete self;
+    }, nullptr, nullptr);
+    return thisArg;
+}
+
+// engine.submit({ block, hash, nonce, difficulty, miner }) -> job id
+napi_value submit(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    Engine* self = unwrap(env, info, argc, argv);
+    if (!self) {
+        return nullptr;
+    }
+    uint64_t block = 0, nonce = 0, difficulty = 0;
+    if (argc < 1 || !integerProperty(env, argv[0], "block", block) || !integerProperty(env, argv[0], "difficulty", difficulty)) {
+        return fail(env, "Expected { block, hash, nonce, difficulty, miner }.");
+    }
+    integerProperty(env, argv[0], "nonce", nonce);
+    const uint64_t job = kale_submit(self->engine, static_cast<uint32_t>(block), stringProperty(env, argv[0], "hash").c_str(),
+        nonce, static_cast<int>(difficulty), stringProperty(env, argv[0], "miner").c_str());
+    if (!job) {
+        return fail(env, kale_last_error());
+    }
+    napi_value result;
+    napi_create_double(env, static_cast<double>(job), &result);
+    return result;
+}
+
+// engine.cancel([job]) -> whether it was mining
+napi_value cancel(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    Engine* self = unwrap(env, info, argc, argv);
+    if (!self) {
+        return nullptr;
+    }
+    int64_t job = 0;
+    if (argc > 0) {
+        napi_get_value_int64(env, argv[0], &job);
+    }
+    napi_value result;
+    napi_get_boolean(env, kale_cancel(self->engine, static_cast<uint64_t>(job)) == 0, &result);
+    return result;
+}
+
+napi_value status(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    Engine* self = unwrap(env, info, argc, nullptr);
+    if (!self) {
+        return nullptr;
+    }
+    kale_status current;
+    kale_poll(self->engine, &current);
+    return toObject(env, current);
+}
+
+// engine.onStatus(callback, progressMs): progress while mining and the solution; null removes it.
+napi_value onStatus(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    Engine* self = unwrap(env, info, argc, argv);
+    if (!self) {
+        return nullptr;
+    }
+    clearStatus(self);
+    napi_valuetype type = napi_undefined;
+    if (argc > 0) {
+        napi_typeof(env, argv[0], &type);
+    }
+    if (type != napi_function) {
+        return nullptr;
+    }
+    uint32_t progressMs = 0;
+    if (argc > 1) {
+        napi_get_value_uint32(env, argv[1], &progressMs);
+    }
+    napi_value name;
+    napi_create_string_utf8(env, "kaleminer.status", NAPI_AUTO_LENGTH, &name);
+    if (napi_create_threadsafe_function(env, argv[0], nullptr, name, 0, 1, nullptr, nullptr, nullptr, callStatus,
+            &self->onStatus) != napi_ok) {
+        return fail(env, "Failed to create the status callback.");
+    }
+    kale_set_callback(self->engine, deliverStatus, self->onStatus, progressMs);
+    return nullptr;
+}
+
+// engine.close(): cancels the job and stops the workers.
+napi_value closeEngine(napi_env env, napi_callback_info info) {
+    napi_value thisArg;
+    void* self = nullptr;
+    napi_get_cb_info(env, info, nullptr, nullptr, &thisArg, nullptr);
+    if (napi_unwrap(env, thisArg, &self) == napi_ok && self) {
+        close(static_cast<Engine*>(self));
+    }
+    return nullptr;
+}
+
+napi_value init(napi_env env, napi_value exports) {
+    const napi_property_descriptor methods[] = {
+        {"submit", nullptr, submit, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"cancel", nullptr, cancel, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"status", nullptr, status, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"onStatus", nullptr, onStatus, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"close", nullptr, closeEngine, nullptr, nullptr, nullptr, napi_default, nullptr},
+    };
+    napi_value engine, version;
+    napi_define_class(env, "Engine", NAPI_AUTO_LENGTH, construct, nullptr, sizeof(methods) / sizeof(methods[0]),
+        methods, &engine);
+    napi_set_named_property(env, exports, "Engine", engine);
+    napi_create_string_utf8(env, kale_version(), NAPI_AUTO_LENGTH, &version);
+    napi_set_named_property(env, exports, "version", version);
+    return exports;
+}
+
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
@@ -0,0 +1,249 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kaleminer.h"
+#include "utils/engine.h"
+#include "utils/keccak_dispatch.h"
+#include "utils/mining.h"
+#include "utils/topology.h"
+
+static const std::uint64_t batchSize = 10000000;
+// Nonces per chunk, which bounds how long a submitted or cancelled job takes to preempt the workers.
+static const std::uint64_t chunkSize = 1024;
+static const unsigned rateInterval = 1000;
+// Metrics slots are process-wide, so is the engine.
+static std::atomic<bool> engineCreated(false);
+static thread_local std::string lastError;
+
+struct kale_engine {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::shared_ptr<MiningJob> job;
+    std::uint64_t jobId = 0;
+    int state = KALE_IDLE;
+    std::chrono::steady_clock::time_point submitted;
+    double hashRate = 0;
+    unsigned progressMs = 0;
+    bool running = true;
+
+    // Held while the callback runs, so replacing it waits for the running one.
+    std::mutex callbackMutex;
+    kale_callback callback = nullptr;
+    void* user = nullptr;
+
+    std::unique_ptr<MiningEngine> engine;
+    std::thread reporter;
+
+    // Caller holds `mutex`.
+    kale_status status() const {
+        kale_status status{};
+        status.job = jobId;
+        status.state = state;
+        status.hash_rate = hashRate;
+        if (job) {
+            status.hashes = job->hashes.load(std::memory_order_relaxed);
+            status.elapsed = secondsSince(submitted);
+            if (state == KALE_SOLVED) {
+                status.nonce = job->nonce;
+                std::copy(job->digest.begin(), job->digest.end(), status.hash);
+                status.zeros = zeroNibbles(status.hash);
+            }
+        }
+        return status;
+    }
+
+    void notify(const kale_status& status) {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        if (callback) {
+            callback(&status, user);
+        }
+    }
+
+    // Worker that claimed `solved`; `job->id` carries the job id.
+    void solved(MiningJob& solvedJob) {
+        kale_status current;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!job || job.get() != &solvedJob) {
+                return;
+            }
+            state = KALE_SOLVED;
+            current = status();
+        }
+        notify(current);
+    }
+
+    // Measures the engine rate every second and reports progress every `progressMs`.
+    void report() {
+        TRACE_THREAD("reporter");
+        auto last = std::chrono::steady_clock::now(), reported = last;
+        std::uint64_t counted = metrics.totalHashes();
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            const unsigned interval = progressMs ? std::min(progressMs, rateInterval) : rateInterval;
+            changed.wait_for(lock, std::chrono::milliseconds(interval));
+            if (!running) {
+                break;
+            }
+            const auto now = std::chrono::steady_clock::now();
+            const double seconds = std::chrono::duration<double>(now - last).count();
+            if (seconds > 0) {
+                const std::uint64_t hashes = metrics.totalHashes();
+                hashRate = (hashes - counted) / seconds;
+                counted = hashes;
+                last = now;
+            }
+            if (state != KALE_MINING || !progressMs || now - reported < std::chrono::milliseconds(progressMs)) {
+                continue;
+            }
+            reported = now;
+            const kale_status current = status();
+            lock.unlock();
+            notify(current);
+            lock.lock();
+        }
+    }
+};
+
+extern "C" {
+
+kale_engine* kale_engine_create(int threads, const char* keccak, const char* affinity) {
+    bool expected = false;
+    if (!engineCreated.compare_exchange_strong(expected, true)) {
+        lastError = "An engine already exists in this process.";
+        return nullptr;
+    }
+    try {
+        const KeccakBackend* backend = selectKeccakBackend(keccak && *keccak ? keccak : "auto", false);
+        if (!backend) {
+            throw std::invalid_argument("Keccak backend is not available.");
+        }
+        const std::string mode = affinity ? affinity : "none";
+        if (mode != "none" && mode != "core" && mode != "logical") {
+            throw std::invalid_argument("Unknown affinity (expected none, core or logical).");
+        }
+        std::vector<CpuInfo> placement;
+        if (mode != "none") {
+            placement = placeWorkers(readTopology(), mode == "core" ? Affinity::Core : Affinity::Logical);
+        }
+        size_t workers = threads > 0 ? static_cast<size_t>(threads) : placement.size();
+        if (workers == 0) {
+            workers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        metrics.init(std::vector<std::string>(workers, "cpu"));
+
+        auto engine = std::make_unique<kale_engine>();
+        kale_engine* self = engine.get();
+        engine->engine = std::make_unique<MiningEngine>(workers, placement, *backend,
+            [self](MiningJob& job) { self->solved(job); });
+        engine->reporter = std::thread([self]() { self->report(); });
+        return engine.release();
+    } catch (const std::exception& e) {
+        lastError = e.what();
+        engineCreated.store(false);
+        return nullptr;
+    }
+}
+
+void kale_engine_destroy(kale_engine* engine) {
+    if (!engine) {
+        return;
+    }
+    engine->engine.reset();
+    {
+        std::lock_guard<std::mutex> lock(engine->mutex);
+        engine->running = false;
+        engine->changed.notify_all();
+    }
+    engine->reporter.join();
+    delete engine;
+    engineCreated.store(false);
+}
+
+uint64_t kale_submit(kale_engine* engine, uint32_t block, const char* hash, uint64_t nonce, int difficulty,
+    const char* miner) {
+    if (!engine || !hash || !miner) {
+        lastError = "Invalid argument.";
+        return 0;
+    }
+    try {
+        auto job = makeJob(block, hash, nonce, difficulty, miner, engine->engine->workers(), batchSize, chunkSize);
+        std::lock_guard<std::mutex> lock(engine->mutex);
+        job->id = std::to_string(++engine->jobId);
+        engine->job = job;
+        engine->state = KALE_MINING;
+        engine->submitted = std::chrono::steady_clock::now();
+        engine->engine->publish(job);
+        return engine->jobId;
+    } catch (const std::exception& e) {
+        lastError = e.what();
+        return 0;
+    }
+}
+
+int kale_cancel(kale_engine* engine, uint64_t job) {
+    if (!engine) {
+        lastError = "Invalid argument.";
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(engine->mutex);
+    if (engine->state != KALE_MINING || (job && job != engine->jobId)) {
+        lastError = "Job is not mining.";
+        return -1;
+    }
+    engine->state = KALE_CANCELLED;
+    engine->engine->publish(nullptr);
+    return 0;
+}
+
+int kale_poll(kale_engine* engine, kale_status* status) {
+    if (!engine || !status) {
+        lastError = "Invalid argument.";
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(engine->mutex);
+    *status = engine->status();
+    return 0;
+}
+
+int kale_set_callback(kale_engine* engine, kale_callback callback, void* user, unsigned progress_ms) {
+    if (!engine) {
+        lastError = "Invalid argument.";
+        return -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(engine->callbackMutex);
+        engine->callback = callback;
+        engine->user = user;
+    }
+    std::lock_guard<std::mutex> lock(engine->mutex);
+    engine->progressMs = progress_ms;
+    engine->changed.notify_all();
+    return 0;
+}
+
+const char* kale_last_error(void) {
+    return lastError.c_str();
+}
+
+const char* kale_version(void) {
+    return "1.0.0";
+}
+
+}
@@ -0,0 +1,84 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    libkaleminer: C API of the CPU mining engine (make lib). An engine keeps its worker pool
+    between jobs; submitting a job preempts the current one within one chunk. Results and
+    progress are read with kale_poll() or delivered to a callback.
+*/
+
+#ifndef KALEMINER_H
+#define KALEMINER_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define KALE_API __declspec(dllexport)
+#else
+#define KALE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct kale_engine kale_engine;
+
+typedef enum {
+    KALE_IDLE = 0,
+    KALE_MINING = 1,
+    KALE_SOLVED = 2,
+    KALE_CANCELLED = 3
+} kale_state;
+
+typedef struct {
+    uint64_t job;        /* Id returned by kale_submit (0: no job submitted yet). */
+    int state;           /* kale_state of that job. */
+    uint64_t hashes;     /* Hashes computed for the job. */
+    double hash_rate;    /* Engine hash rate (H/s) over the last progress interval. */
+    double elapsed;      /* Seconds since the job was submitted. */
+    uint64_t nonce;      /* Solution, valid in KALE_SOLVED. */
+    uint8_t hash[32];
+    int zeros;           /* Leading zero nibbles of `hash`. */
+} kale_status;
+
+/* Invoked with progress every `progress_ms` while a job is mining (reporter thread) and once
+   with the solution (worker thread). Must not call kale_set_callback or kale_engine_destroy. */
+typedef void (*kale_callback)(const kale_status* status, void* user);
+
+/* Starts `threads` workers (<= 0: one per CPU). `keccak`: backend name or NULL/"auto";
+   `affinity`: NULL/"none", "core" or "logical". One engine per process. NULL on error. */
+KALE_API kale_engine* kale_engine_create(int threads, const char* keccak, const char* affinity);
+
+/* Cancels the current job and joins the workers; no callback runs after it returns. */
+KALE_API void kale_engine_destroy(kale_engine* engine);
+
+/* Mines `difficulty` leading zero nibbles for (block, base64 `hash`, `miner` address) from
+   `nonce`, replacing the current job. Returns the job id, or 0 on error. */
+KALE_API uint64_t kale_submit(kale_engine* engine, uint32_t block, const char* hash, uint64_t nonce,
+    int difficulty, const char* miner);
+
+/* Cancels `job` (0: whichever is current) and idles the workers. Returns 0 if it was
+   mining, -1 otherwise. */
+KALE_API int kale_cancel(kale_engine* engine, uint64_t job);
+
+/* Status of the latest job. Returns 0, or -1 on error. */
+KALE_API int kale_poll(kale_engine* engine, kale_status* status);
+
+/* Replaces the callback (NULL: none), waiting for a running one to return. Progress is
+   reported every `progress_ms` (0: solutions only). Returns 0, or -1 on error. */
+KALE_API int kale_set_callback(kale_engine* engine, kale_callback callback, void* user, unsigned progress_ms);
+
+/* Message of the last failed call on the calling thread. */
+KALE_API const char* kale_last_error(void);
+
+KALE_API const char* kale_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,15 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+*/
+
+// Compiled with -mavx512f (/arch:AVX512); only called after runtime detection.
+
+#include "utils/keccak_simd.h"
+
+bool keccakSearchAvx512(const Keccak256Miner& job, uint64_t mask, uint64_t start, uint64_t count, uint64_t& nonce) {
+    return keccakSearch<U64x8>(job, mask, start, count, nonce);
+}
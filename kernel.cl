@@ -18,8 +18,10 @@ inline int load(__global volatile int *p) { return atomic_cmpxchg(p, 0, 0); }
 #endif
 
 #define maxDataSize 256
+// Largest work-group of runBest (size of its local reduction array).
+#define maxBestGroupSize 1024
 
-void keccak256(const uchar* input, size_t size, uchar* output);  // See utils/keccak.cl (concatenated at runtime).
+void keccak256(const uchar* input, size_t size, uchar* output);  // See utils/keccak.cl (concatenated when the program is built).
 
 inline void updateNonce(ulong val, uchar* buffer) {
     for (int i = 0; i < 8; i++) {
@@ -35,7 +37,16 @@ inline int check(const uchar* hash, int difficulty) {
         zeros += (zero & 2) | (~zero & ((-((hash[i] >> 4) == 0)) & 1));
         i += ((hash[i] != 0 || zeros >= difficulty) ? (32 - i) : 0);
     }
-    return zeros == difficulty;
+    return zeros >= difficulty;
+}
+
+// Leading zero nibbles of the hash.
+inline int zeroNibbles(const uchar* hash) {
+    for (int i = 0; i < 32; ++i) {
+        if (hash[i] != 0)
+            return 2 * i + ((hash[i] >> 4) == 0);
+    }
+    return 64;
 }
 
 inline void copy(uchar* dest, const __global uchar* src, int size) {
@@ -49,7 +60,7 @@ __kernel void run(int dataSize, ulong startNonce, int nonceOffset, ulong batchSi
 ) {
     ulong idx = get_global_id(0);
     ulong stride = get_global_size(0);
-    if (dataSize > maxDataSize || idx >= batchSize || load(found) == 1)
+    if (dataSize > maxDataSize || idx >= batchSize || load(found))
         return;
     ulong nonceEnd = startNonce + batchSize;
     uchar threadData[maxDataSize];
@@ -69,7 +80,70 @@ __kernel void run(int dataSize, ulong startNonce, int nonceOffset, ulong batchSi
             }
             return;
         }
-        if (load(found) == 1)
+        if (load(found))
             return;
     }
 }
+
+// Best-of-batch search: every nonce of the batch is hashed and the result is the hash with the
+// most leading zero nibbles, not the first one found at the target. Each work-item keeps its
+// best hash, the work-group reduces them in local memory and its winner does one atomic max on
+// `found`, which holds (zeros << 16 | group) and accumulates over the batches of a job. A group
+// that raises it writes its nonce and hash to its own slot of validNonce/output, so the slot the
+// final key names is never overwritten by a worse result. Once the key reaches the difficulty,
+// the following batches exit.
+__kernel void runBest(int dataSize, ulong startNonce, int nonceOffset, ulong batchSize, int difficulty,
+    __global const uchar* deviceData, __global atomic_int_t* found, __global uchar* output, __global ulong* validNonce
+) {
+    __local int keys[maxBestGroupSize];
+    uint lid = get_local_id(0);
+    uint size = get_local_size(0);
+    ulong idx = get_global_id(0);
+    ulong stride = get_global_size(0);
+    int bestZeros = -1;
+    ulong bestNonce = 0;
+    uchar bestHash[32];
+
+    // No early return: every work-item must reach the barriers.
+    if (dataSize <= maxDataSize && (load(found) >> 16) < difficulty) {
+        ulong nonceEnd = startNonce + batchSize;
+        uchar threadData[maxDataSize];
+        copy(threadData, deviceData, dataSize);
+        for (ulong nonce = startNonce + idx; nonce < nonceEnd; nonce += stride) {
+            updateNonce(nonce, &threadData[nonceOffset]);
+            uchar hash[32];
+            keccak256(threadData, dataSize, hash);
+            int zeros = zeroNibbles(hash);
+            if (zeros > bestZeros) {
+                bestZeros = zeros;
+                bestNonce = nonce;
+                for (int i = 0; i < 32; ++i) {
+                    bestHash[i] = hash[i];
+                }
+            }
+        }
+    }
+
+    // Ties go to the highest local id; work-items without a nonce keep -1.
+    keys[lid] = bestZeros < 0 ? -1 : (bestZeros << 10) | (int)lid;
+    barrier(CLK_LOCAL_MEMORY_FENCE);
+    for (uint active = size; active > 1;) {
+        uint half = (active + 1) / 2;
+        if (lid + half < active)
+            keys[lid] = max(keys[lid], keys[lid + half]);
+        barrier(CLK_LOCAL_MEMORY_FENCE);
+        active = half;
+    }
+    int winner = keys[0];
+    if (winner < 0 || (uint)(winner & 0x3ff) != lid)
+        return;
+
+    uint group = get_group_id(0);
+    int key = (bestZeros << 16) | (int)group;
+    if (atomic_max((volatile __global int*)found, key) < key) {
+        for (int i = 0; i < 32; ++i) {
+            output[group * 32 + i] = bestHash[i];
+        }
+        validNonce[group] = bestNonce;
+    }
+}
@@ -13,6 +13,7 @@
 #include <cstddef>
 
 #include "utils/keccak.cuh"
+#include "utils/trace.h"
 
 constexpr int maxDataSize = 256;
 __constant__ std::uint8_t deviceData[maxDataSize];
@@ -42,7 +43,7 @@ __device__ __forceinline__ bool check(const std::uint8_t* hash, int difficulty)
         zeros += (zero & 2) | (~zero & ((-((hash[i] >> 4) == 0)) & 1));
         i += ((hash[i] != 0) | (zeros >= difficulty)) * (32 - i);
     }
-    return zeros == difficulty;
+    return zeros >= difficulty;
 }
 
 __device__ __forceinline__ void vCopy(std::uint8_t* dest, const std::uint8_t* src, int size) {
@@ -97,8 +98,10 @@ extern "C" int executeKernel(int deviceId, std::uint8_t* data, int dataSize, std
     int* deviceFound;
     std::uint64_t* deviceNonce;
     cudaDeviceProp deviceProp;
+    TRACE_STEPS(trace, "device setup");
     CUDA_CALL(cudaSetDevice(deviceId));
     CUDA_CALL(cudaGetDeviceProperties(&deviceProp, deviceId));
+    TRACE_NEXT(trace, "buffer transfer");
     CUDA_CALL(cudaMalloc((void**)&deviceFound, sizeof(int)));
     CUDA_CALL(cudaMemcpy(deviceFound, &found, sizeof(int), cudaMemcpyHostToDevice));
     CUDA_CALL(cudaMemcpyToSymbol(deviceData, data, dataSize));
@@ -119,9 +122,11 @@ extern "C" int executeKernel(int deviceId, std::uint8_t* data, int dataSize, std
         blocks = deviceProp.maxGridSize[0];
     }
     std::uint64_t adjustedBatchSize = blocks * threads;
+    TRACE_NEXT(trace, "kernel", startNonce);
     run<<<(unsigned int)blocks, threads>>>(dataSize, startNonce,
         nonceOffset, adjustedBatchSize, difficulty, deviceFound, deviceOutput, deviceNonce);
     CUDA_CALL(cudaDeviceSynchronize());
+    TRACE_NEXT(trace, "buffer transfer");
     CUDA_CALL(cudaMemcpy(output, deviceOutput, outputSize, cudaMemcpyDeviceToHost));
     CUDA_CALL(cudaMemcpy(&found, deviceFound, sizeof(int), cudaMemcpyDeviceToHost));
     CUDA_CALL(cudaMemcpy(validNonce, deviceNonce, sizeof(std::uint64_t), cudaMemcpyDeviceToHost));
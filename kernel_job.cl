@@ -0,0 +1,213 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Job-specialized OpenCL kernel (--cl-kernel job), built once per job. The host passes the
+    padded single-block message as 17 lane constants (nonce bytes zeroed), the lane and bit
+    shift of the nonce, the difficulty and the found-flag polling interval:
+        -D M0=... -D M16=... -D NONCE_LANE=0 -D NONCE_SHIFT=32 -D DIFFICULTY=8 -D POLL_INTERVAL=64
+    The state is 25 ulong variables, so each hash is the nonce injection plus 24 rounds on
+    registers; all message lanes fold into the first round.
+
+    With -D VECTOR_WIDTH=2 or 4 (--cl-kernel vector) the program also has runJobVector, where
+    the 25 variables are ulong2/ulong4 holding the states of consecutive nonces, for devices
+    with wide integer SIMD (CPU runtimes such as pocl, AMD GCN).
+*/
+
+#ifndef VECTOR_WIDTH
+#define VECTOR_WIDTH 1
+#endif
+
+#define ROTL(x, n) rotate((x), (ulong)(n))
+
+__constant ulong jobRoundConstants[24] = {
+    0x0000000000000001UL, 0x0000000000008082UL, 0x800000000000808aUL, 0x8000000080008000UL,
+    0x000000000000808bUL, 0x0000000080000001UL, 0x8000000080008081UL, 0x8000000000008009UL,
+    0x000000000000008aUL, 0x0000000000000088UL, 0x0000000080008009UL, 0x000000008000000aUL,
+    0x000000008000808bUL, 0x800000000000008bUL, 0x8000000000008089UL, 0x8000000000008003UL,
+    0x8000000000008002UL, 0x8000000000000080UL, 0x000000000000800aUL, 0x800000008000000aUL,
+    0x8000000080008081UL, 0x8000000000008080UL, 0x0000000080000001UL, 0x8000000080008008UL
+};
+
+// One Keccak-f[1600] round on a00..a24 (lane x + 5y), with theta, rho and pi fused.
+#define KECCAK_ROUND(rc) \
+    c0 = a00 ^ a05 ^ a10 ^ a15 ^ a20; c1 = a01 ^ a06 ^ a11 ^ a16 ^ a21; \
+    c2 = a02 ^ a07 ^ a12 ^ a17 ^ a22; c3 = a03 ^ a08 ^ a13 ^ a18 ^ a23; \
+    c4 = a04 ^ a09 ^ a14 ^ a19 ^ a24; \
+    d0 = c4 ^ ROTL(c1, 1); d1 = c0 ^ ROTL(c2, 1); d2 = c1 ^ ROTL(c3, 1); \
+    d3 = c2 ^ ROTL(c4, 1); d4 = c3 ^ ROTL(c0, 1); \
+    b00 = a00 ^ d0; b01 = ROTL(a06 ^ d1, 44); b02 = ROTL(a12 ^ d2, 43); b03 = ROTL(a18 ^ d3, 21); b04 = ROTL(a24 ^ d4, 14); \
+    b05 = ROTL(a03 ^ d3, 28); b06 = ROTL(a09 ^ d4, 20); b07 = ROTL(a10 ^ d0, 3); b08 = ROTL(a16 ^ d1, 45); b09 = ROTL(a22 ^ d2, 61); \
+    b10 = ROTL(a01 ^ d1, 1); b11 = ROTL(a07 ^ d2, 6); b12 = ROTL(a13 ^ d3, 25); b13 = ROTL(a19 ^ d4, 8); b14 = ROTL(a20 ^ d0, 18); \
+    b15 = ROTL(a04 ^ d4, 27); b16 = ROTL(a05 ^ d0, 36); b17 = ROTL(a11 ^ d1, 10); b18 = ROTL(a17 ^ d2, 15); b19 = ROTL(a23 ^ d3, 56); \
+    b20 = ROTL(a02 ^ d2, 62); b21 = ROTL(a08 ^ d3, 55); b22 = ROTL(a14 ^ d4, 39); b23 = ROTL(a15 ^ d0, 41); b24 = ROTL(a21 ^ d1, 2); \
+    a00 = b00 ^ (~b01 & b02); a01 = b01 ^ (~b02 & b03); a02 = b02 ^ (~b03 & b04); \
+    a03 = b03 ^ (~b04 & b00); a04 = b04 ^ (~b00 & b01); \
+    a05 = b05 ^ (~b06 & b07); a06 = b06 ^ (~b07 & b08); a07 = b07 ^ (~b08 & b09); \
+    a08 = b08 ^ (~b09 & b05); a09 = b09 ^ (~b05 & b06); \
+    a10 = b10 ^ (~b11 & b12); a11 = b11 ^ (~b12 & b13); a12 = b12 ^ (~b13 & b14); \
+    a13 = b13 ^ (~b14 & b10); a14 = b14 ^ (~b10 & b11); \
+    a15 = b15 ^ (~b16 & b17); a16 = b16 ^ (~b17 & b18); a17 = b17 ^ (~b18 & b19); \
+    a18 = b18 ^ (~b19 & b15); a19 = b19 ^ (~b15 & b16); \
+    a20 = b20 ^ (~b21 & b22); a21 = b21 ^ (~b22 & b23); a22 = b22 ^ (~b23 & b24); \
+    a23 = b23 ^ (~b24 & b20); a24 = b24 ^ (~b20 & b21); \
+    a00 ^= (rc)
+
+inline ulong bswap64(ulong x) {
+    x = ((x & 0x00ff00ff00ff00ffUL) << 8) | ((x >> 8) & 0x00ff00ff00ff00ffUL);
+    x = ((x & 0x0000ffff0000ffffUL) << 16) | ((x >> 16) & 0x0000ffff0000ffffUL);
+    return (x << 32) | (x >> 32);
+}
+
+// Digest word `index` (big-endian) against the leading-zero nibbles it must hold.
+inline int wordMeets(ulong lane, int index) {
+    const int nibbles = DIFFICULTY - 16 * index;
+    return nibbles <= 0 || (nibbles >= 16 ? lane == 0 : bswap64(lane) < (1UL << (64 - 4 * nibbles)));
+}
+
+// Nonce bytes (big-endian in the message) land in lane NONCE_LANE and, unless aligned, the next one.
+#define NONCE_PART(i) (NONCE_LANE == (i) ? low : NONCE_LANE + 1 == (i) ? high : 0UL)
+
+__kernel void runJob(ulong startNonce, ulong batchSize,
+    __global volatile int* found, __global uchar* output, __global ulong* validNonce
+) {
+    ulong idx = get_global_id(0);
+    ulong stride = get_global_size(0);
+    if (idx >= batchSize || *found)
+        return;
+    ulong nonceEnd = startNonce + batchSize;
+    int poll = 0;
+    for (ulong nonce = startNonce + idx; nonce < nonceEnd; nonce += stride) {
+        const ulong bytes = bswap64(nonce);
+        const ulong low = bytes << NONCE_SHIFT;
+#if NONCE_SHIFT
+        const ulong high = bytes >> (64 - NONCE_SHIFT);
+#else
+        const ulong high = 0;
+#endif
+        ulong a00 = M0 ^ NONCE_PART(0), a01 = M1 ^ NONCE_PART(1), a02 = M2 ^ NONCE_PART(2), a03 = M3 ^ NONCE_PART(3);
+        ulong a04 = M4 ^ NONCE_PART(4), a05 = M5 ^ NONCE_PART(5), a06 = M6 ^ NONCE_PART(6), a07 = M7 ^ NONCE_PART(7);
+        ulong a08 = M8 ^ NONCE_PART(8), a09 = M9 ^ NONCE_PART(9), a10 = M10 ^ NONCE_PART(10), a11 = M11 ^ NONCE_PART(11);
+        ulong a12 = M12 ^ NONCE_PART(12), a13 = M13 ^ NONCE_PART(13), a14 = M14 ^ NONCE_PART(14), a15 = M15 ^ NONCE_PART(15);
+        ulong a16 = M16 ^ NONCE_PART(16), a17 = 0, a18 = 0, a19 = 0, a20 = 0, a21 = 0, a22 = 0, a23 = 0, a24 = 0;
+        ulong c0, c1, c2, c3, c4, d0, d1, d2, d3, d4;
+        ulong b00, b01, b02, b03, b04, b05, b06, b07, b08, b09, b10, b11, b12;
+        ulong b13, b14, b15, b16, b17, b18, b19, b20, b21, b22, b23, b24;
+        for (int round = 0; round < 24; ++round) {
+            KECCAK_ROUND(jobRoundConstants[round]);
+        }
+        if (wordMeets(a00, 0) && wordMeets(a01, 1) && wordMeets(a02, 2) && wordMeets(a03, 3)) {
+            if (atomic_cmpxchg(found, 0, 1) == 0) {
+                const ulong digest[4] = {a00, a01, a02, a03};
+                for (int i = 0; i < 32; ++i) {
+                    output[i] = (uchar)(digest[i / 8] >> (8 * (i % 8)));
+                }
+                *validNonce = nonce;
+            }
+            return;
+        }
+        // A plain read every POLL_INTERVAL hashes instead of an atomic per hash.
+        if (++poll == POLL_INTERVAL) {
+            poll = 0;
+            if (*found)
+                return;
+        }
+    }
+}
+
+#if VECTOR_WIDTH == 2 || VECTOR_WIDTH == 4
+#define CONCAT_(a, b) a##b
+#define CONCAT(a, b) CONCAT_(a, b)
+typedef CONCAT(ulong, VECTOR_WIDTH) vlong;
+typedef CONCAT(long, VECTOR_WIDTH) vmask;
+#define VSTORE CONCAT(vstore, VECTOR_WIDTH)
+#if VECTOR_WIDTH == 4
+#define NONCE_OFFSETS ((vlong)(0, 1, 2, 3))
+#else
+#define NONCE_OFFSETS ((vlong)(0, 1))
+#endif
+
+// KECCAK_ROUND expands ROTL where it is used: rotate() takes the count as the same vector type.
+#undef ROTL
+#define ROTL(x, n) rotate((x), (vlong)(n))
+
+inline vlong bswap64v(vlong x) {
+    x = ((x & 0x00ff00ff00ff00ffUL) << 8) | ((x >> 8) & 0x00ff00ff00ff00ffUL);
+    x = ((x & 0x0000ffff0000ffffUL) << 16) | ((x >> 16) & 0x0000ffff0000ffffUL);
+    return (x << 32) | (x >> 32);
+}
+
+// wordMeets on every state: all bits set in the lanes that meet.
+inline vmask wordMeetsv(vlong lane, int index) {
+    const int nibbles = DIFFICULTY - 16 * index;
+    if (nibbles <= 0)
+        return (vmask)(-1);
+    return nibbles >= 16 ? lane == (vlong)(0) : bswap64v(lane) < (vlong)(1UL << (64 - 4 * nibbles));
+}
+
+#define NONCE_PARTV(i) (NONCE_LANE == (i) ? low : NONCE_LANE + 1 == (i) ? high : (vlong)(0))
+
+// runJob with VECTOR_WIDTH consecutive nonces per iteration; the host launches one work-item
+// per VECTOR_WIDTH nonces. A hit reports the lowest matching nonce of the vector.
+__kernel void runJobVector(ulong startNonce, ulong batchSize,
+    __global volatile int* found, __global uchar* output, __global ulong* validNonce
+) {
+    ulong idx = get_global_id(0) * VECTOR_WIDTH;
+    ulong stride = get_global_size(0) * VECTOR_WIDTH;
+    if (idx >= batchSize || *found)
+        return;
+    ulong nonceEnd = startNonce + batchSize;
+    int poll = 0;
+    for (ulong first = startNonce + idx; first < nonceEnd; first += stride) {
+        const vlong nonces = (vlong)(first) + NONCE_OFFSETS;
+        const vlong bytes = bswap64v(nonces);
+        const vlong low = bytes << NONCE_SHIFT;
+#if NONCE_SHIFT
+        const vlong high = bytes >> (64 - NONCE_SHIFT);
+#else
+        const vlong high = (vlong)(0);
+#endif
+        vlong a00 = M0 ^ NONCE_PARTV(0), a01 = M1 ^ NONCE_PARTV(1), a02 = M2 ^ NONCE_PARTV(2), a03 = M3 ^ NONCE_PARTV(3);
+        vlong a04 = M4 ^ NONCE_PARTV(4), a05 = M5 ^ NONCE_PARTV(5), a06 = M6 ^ NONCE_PARTV(6), a07 = M7 ^ NONCE_PARTV(7);
+        vlong a08 = M8 ^ NONCE_PARTV(8), a09 = M9 ^ NONCE_PARTV(9), a10 = M10 ^ NONCE_PARTV(10), a11 = M11 ^ NONCE_PARTV(11);
+        vlong a12 = M12 ^ NONCE_PARTV(12), a13 = M13 ^ NONCE_PARTV(13), a14 = M14 ^ NONCE_PARTV(14), a15 = M15 ^ NONCE_PARTV(15);
+        vlong a16 = M16 ^ NONCE_PARTV(16), a17 = (vlong)(0), a18 = a17, a19 = a17, a20 = a17, a21 = a17, a22 = a17;
+        vlong a23 = a17, a24 = a17;
+        vlong c0, c1, c2, c3, c4, d0, d1, d2, d3, d4;
+        vlong b00, b01, b02, b03, b04, b05, b06, b07, b08, b09, b10, b11, b12;
+        vlong b13, b14, b15, b16, b17, b18, b19, b20, b21, b22, b23, b24;
+        for (int round = 0; round < 24; ++round) {
+            KECCAK_ROUND(jobRoundConstants[round]);
+        }
+        const vmask meets = wordMeetsv(a00, 0) & wordMeetsv(a01, 1) & wordMeetsv(a02, 2) & wordMeetsv(a03, 3)
+            & (nonces < (vlong)(nonceEnd));
+        if (any(meets)) {
+            if (atomic_cmpxchg(found, 0, 1) == 0) {
+                long hits[VECTOR_WIDTH];
+                ulong digest[4][VECTOR_WIDTH];
+                VSTORE(meets, 0, hits);
+                VSTORE(a00, 0, digest[0]);
+                VSTORE(a01, 0, digest[1]);
+                VSTORE(a02, 0, digest[2]);
+                VSTORE(a03, 0, digest[3]);
+                int lane = 0;
+                while (!hits[lane])
+                    ++lane;
+                for (int i = 0; i < 32; ++i) {
+                    output[i] = (uchar)(digest[i / 8][lane] >> (8 * (i % 8)));
+                }
+                *validNonce = first + lane;
+            }
+            return;
+        }
+        if (++poll == POLL_INTERVAL) {
+            poll = 0;
+            if (*found)
+                return;
+        }
+    }
+}
+#endif
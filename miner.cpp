@@ -18,9 +18,22 @@
 #include <functional>
 #include <sstream>
 #include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <cerrno>
+#include <csignal>
 
 #include "utils/keccak.h"
+#include "utils/keccak_dispatch.h"
 #include "utils/misc.h"
+#include "utils/channel.h"
+#include "utils/json.h"
+#include "utils/mining.h"
+#include "utils/topology.h"
+#include "utils/tuner.h"
+#include "utils/coordinator.h"
+#include "utils/engine.h"
 
 #define GPU_NONE 0
 #define GPU_CUDA 1
@@ -42,97 +55,102 @@ extern "C" int executeKernel(int deviceId, std::uint8_t* data, int dataSize, std
 #endif
 extern "C" int executeKernel(int deviceId, std::uint8_t* data, int dataSize, std::uint64_t startNonce, int nonceOffset,
     std::uint64_t batchSize, int difficulty, int threadsPerBlock, std::uint8_t* output, std::uint64_t* validNonce, bool showDeviceInfo);
+extern "C" int executePipeline(int deviceId, std::uint8_t* data, int dataSize, int nonceOffset, int difficulty,
+    int threadsPerBlock, int depth, std::uint8_t* output, std::uint64_t* validNonce, bool showDeviceInfo,
+    bool (*nextRange)(std::uint64_t* nonce, std::uint64_t* count, void* user),
+    void (*completed)(std::uint64_t nonce, std::uint64_t count, double seconds, void* user), bool (*stopped)(void* user),
+    void* user);
+extern "C" bool selectOpenCLKernel(const char* name);
+extern "C" int openclDeviceCount();
+extern "C" bool openclDeviceName(int deviceId, char* name, size_t size);
+extern "C" int openclWorkGroupLimit(int deviceId);
 #endif
 
 static const std::uint64_t defaultBatchSize = 10000000;
 static const int defaultMaxThreads = 4;
+// OpenCL batches kept in flight (--pipeline); 1 runs one batch at a time.
+static const int defaultPipelineDepth = 2;
+// Target duration of one OpenCL batch: device ranges are sized from measured rates to match it.
+static const double deviceBatchSeconds = 0.25;
+// --auto-tune: target duration of one CPU chunk (the cancellation granularity) and its rounding.
+static const double cpuChunkSeconds = 0.01;
+static const std::uint64_t cpuChunkGranularity = 1024;
 static const int hashRateInterval = 5000;
+// Daemon chunk size: bounds how long a worker keeps hashing a job after it is replaced.
+static const int preemptInterval = 1024;
+// Multi-farmer runs re-split the workers at this period (milliseconds).
+static const int rebalanceInterval = 50;
+// --coordinator: lease lifetime (seconds) and largest lease handed out.
+static const double defaultLeaseSeconds = 30;
+static const std::uint64_t maxLeaseSize = 1ULL << 36;
 static std::atomic<bool> found(false);
+// Hash rate of the last GPU batch; CPU rates come from the per-thread metrics counters.
 static std::atomic<std::uint64_t> hashMetric(0);
+static std::atomic<bool> terminated(false);
 
-bool check(const std::vector<std::uint8_t>& hash, int difficulty) {
-    int zeros = 0;
-    for (std::uint8_t byte : hash) {
-        zeros += (byte == 0) ? 2 : ((byte >> 4) == 0 ? 1 : 0);
-        if (byte != 0 || zeros >= difficulty)
-            break;
-    }
-    return zeros >= difficulty;
-}
 
-std::vector<std::uint8_t> prepare(std::uint32_t block, std::uint64_t nonce,
-    const std::string& base64Hash, const std::string& miner, size_t& nonceOffset
-) {
-    auto blockXdr = i32ToBytes(block);
-    auto nonceXdr = i64ToBytes(nonce);
-    auto entropy = base64Decode(base64Hash);
-    auto minerXdr = addressToXdr(miner);
-    std::vector<std::uint8_t> truncated(minerXdr.end() - 32, minerXdr.end());
-    std::vector<std::uint8_t> data;
-    data.reserve(
-        blockXdr.size() +
-        nonceXdr.size() +
-        entropy.size() +
-        truncated.size()
-    );
-    data.insert(data.end(), blockXdr.begin(), blockXdr.end());
-    data.insert(data.end(), nonceXdr.begin(), nonceXdr.end());
-    data.insert(data.end(), entropy.begin(), entropy.end());
-    data.insert(data.end(), truncated.begin(), truncated.end());
-    nonceOffset = blockXdr.size();
-    return data;
+// Reports a daemon or fleet job's solution on the channel it came from.
+void writeSolution(MiningJob& job) {
+    job.channel->writeLine("{\"event\":\"solution\",\"id\":" + jsonQuote(job.id)
+        + ",\"block\":" + std::to_string(job.block) + ",\"hash\":\"" + toHex(job.digest)
+        + "\",\"nonce\":" + std::to_string(job.nonce) + "}");
 }
 
-std::pair<std::vector<std::uint8_t>, std::uint64_t> find(std::uint32_t block, const std::string& base64Hash,
-    std::uint64_t nonce, int difficulty, const std::string& miner,
-    bool verbose, std::uint64_t batchSize) {
-    std::uint64_t counter = 0;
-    int hashRateCounter = 0;
-    size_t nonceOffset = 0;
-    std::vector<std::uint8_t> data = prepare(block, nonce, base64Hash, miner, nonceOffset);
-    if (verbose) {
-        std::cout << "[CPU] Mining batch: " << nonce << " block: " << block
-                  << " difficulty: " << difficulty << " hash: " << base64Hash << std::endl;
-        std::cout.flush();
-    }
-
-    Keccak256 keccak;
-    while (!found.load()) {
-        auto nonceBytes = i64ToBytes(nonce);
-        std::copy(nonceBytes.begin(), nonceBytes.end(), data.begin() + nonceOffset);
-
-        keccak.reset();
-        keccak.update(data.data(), data.size());
-        std::vector<std::uint8_t> result(32);
-        keccak.finalize(result.data());
-
-        if (check(result, difficulty)) {
-            return {result, nonce};
-        }
-
-        nonce++;
-        counter++;
-        if (counter == batchSize) {
-            break;
+// Reads job descriptors from one client until it disconnects. Each job preempts the current one:
+// {"id":"...","block":37,"hash":"<base64>","nonce":0,"difficulty":8,"miner":"G..."}
+// {"cancel":true} idles the workers.
+void serveJobs(std::shared_ptr<LineChannel> channel, MiningEngine& engine, size_t workers, std::uint64_t batchSize,
+    Checkpoint* checkpoint, RateBalancer* tuner) {
+    std::string line;
+    while (channel->readLine(line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
         }
-
-        hashRateCounter += 1;
-        if (hashRateCounter == hashRateInterval) {
-            hashMetric.fetch_add(hashRateCounter, std::memory_order_relaxed);
-            hashRateCounter = 0;
+        std::map<std::string, std::string> fields;
+        std::string id;
+        try {
+            if (!parseJsonObject(line, fields)) {
+                throw std::invalid_argument("Malformed job descriptor.");
+            }
+            id = fields["id"];
+            if (fields.count("cancel")) {
+                engine.publish(nullptr);
+                channel->writeLine("{\"event\":\"idle\",\"id\":" + jsonQuote(id) + "}");
+                continue;
+            }
+            for (const char* key : {"block", "hash", "nonce", "difficulty", "miner"}) {
+                if (!fields.count(key)) {
+                    throw std::invalid_argument(std::string("Missing field: ") + key + ".");
+                }
+            }
+            auto job = makeJob(std::stoul(fields["block"]), fields["hash"], std::stoull(fields["nonce"]),
+                std::stoi(fields["difficulty"]), fields["miner"], workers, batchSize, preemptInterval, checkpoint);
+            job->id = id;
+            job->channel = channel;
+            job->tuner = tuner;
+            restoreResult(*job);
+            engine.publish(job);
+            channel->writeLine("{\"event\":\"job\",\"id\":" + jsonQuote(id)
+                + ",\"block\":" + std::to_string(job->block) + "}");
+        } catch (const std::exception& e) {
+            channel->writeLine("{\"event\":\"error\",\"id\":" + jsonQuote(id)
+                + ",\"message\":" + jsonQuote(e.what()) + "}");
         }
     }
-    return {{}, 0};
+    engine.publish(nullptr);
 }
 
 void monitorHashRate(bool verbose, bool gpu) {
     auto startTime = std::chrono::high_resolution_clock::now();
+    std::uint64_t counted = metrics.totalHashes();
     while (!found.load()) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
         auto currentTime = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> elapsedTime = currentTime - startTime;
-        double hashRate = gpu ? hashMetric.load() : hashMetric.load() / elapsedTime.count();
-        hashMetric.store(0);
+        const std::uint64_t hashes = metrics.totalHashes();
+        // CUDA reports after each (long) synchronous batch, so it shows the last batch rate.
+        double hashRate = gpu && GPU == GPU_CUDA ? hashMetric.load() : (hashes - counted) / elapsedTime.count();
+        counted = hashes;
         startTime = currentTime;
         if (verbose && hashRate > 0) {
             std::cout << std::fixed << std::setprecision(2)
@@ -143,35 +161,546 @@ void monitorHashRate(bool verbose, bool gpu) {
     }
 }
 
+void onTerminate(int) {
+    terminated.store(true);
+}
+
+void reportPlacement(std::ostream& out, const std::vector<CpuInfo>& placement, size_t workers) {
+    for (size_t i = 0; i < workers && !placement.empty(); ++i) {
+        const CpuInfo& cpu = placement[i % placement.size()];
+        out << "[CPU] Affinity: worker " << i << " -> cpu " << cpu.cpu << " (core " << cpu.core
+            << ", package " << cpu.package << ", node " << cpu.node << ")" << std::endl;
+    }
+}
+
+// One farmer in a multi-address run. `deadline` is in seconds from start (0: none).
+struct Farmer {
+    std::string address;
+    int difficulty = 0;
+    double deadline = 0;
+    std::shared_ptr<MiningJob> job;
+    bool reported = false;
+};
+
+// Parses <address>[:<difficulty>[:<deadline seconds>]].
+Farmer parseFarmer(const std::string& spec, int defaultDifficulty) {
+    Farmer farmer;
+    std::stringstream ss(spec);
+    std::string field;
+    std::getline(ss, farmer.address, ':');
+    farmer.difficulty = std::getline(ss, field, ':') && !field.empty() ? std::stoi(field) : defaultDifficulty;
+    farmer.deadline = std::getline(ss, field, ':') && !field.empty() ? std::stod(field) : 0;
+    return farmer;
+}
+
+// Mines all farmers with one worker pool and calls `report` as each one is solved, runs out of
+// time, exhausts its range or the process is terminated. With several farmers, workers are re-split every rebalance
+// interval by the hash rate each farmer needs to expect a solution before its deadline,
+// using the measured per-worker rate; workers switch farmer at their next chunk.
+void mineFarmers(std::vector<Farmer>& farmers, size_t workers, const std::vector<CpuInfo>& placement,
+    const KeccakBackend& keccak, bool verbose, const std::function<void(const Farmer&)>& report) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    std::unique_ptr<std::atomic<int>[]> assignment(new std::atomic<int>[workers]);
+    for (size_t i = 0; i < workers; ++i) {
+        assignment[i].store(farmers.size() == 1 ? 0 : -1);
+    }
+    std::atomic<bool> done(false);
+    std::atomic<int> events(0);
+    std::mutex mutex;
+    std::condition_variable wake;
+
+    auto threads = startWorkers(workers, placement, [&](size_t i) {
+        while (!done.load(std::memory_order_relaxed)) {
+            const int f = assignment[i].load(std::memory_order_relaxed);
+            MiningJob* job = f < 0 ? nullptr : farmers[f].job.get();
+            if (!job || job->stop.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            auto preempted = [&]() { return assignment[i].load(std::memory_order_relaxed) != f; };
+            bool solved = false;
+            {
+                TRACE_SPAN("job", f);
+                solved = find(i, *job, keccak, verbose, preempted);
+            }
+            if (!solved && (preempted() || job->stop.load())) {
+                continue;
+            }
+            // Solved, or the nonce range is exhausted.
+            job->stop.store(true);
+            std::lock_guard<std::mutex> lock(mutex);
+            events++;
+            wake.notify_all();
+        }
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<size_t> lastShares;
+    while (true) {
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        std::vector<size_t> active;
+        for (size_t f = 0; f < farmers.size(); ++f) {
+            Farmer& farmer = farmers[f];
+            if (farmer.reported) {
+                continue;
+            }
+            const bool expired = terminated.load() || (farmer.deadline > 0 && elapsed >= farmer.deadline);
+            if ((farmer.job->solved.load() && !farmer.job->best) || farmer.job->stop.load() || expired) {
+                farmer.job->stop.store(true);
+                farmer.reported = true;
+                report(farmer);
+            } else {
+                active.push_back(f);
+            }
+        }
+        if (active.empty()) {
+            break;
+        }
+        if (farmers.size() > 1) {
+            double horizon = 1, hashes = 0;
+            for (const auto& farmer : farmers) {
+                horizon = std::max(horizon, farmer.deadline - elapsed);
+                hashes += farmer.job->hashes.load(std::memory_order_relaxed);
+            }
+            std::vector<double> need;
+            std::vector<size_t> order(active.size());
+            for (size_t k = 0; k < active.size(); ++k) {
+                const Farmer& farmer = farmers[active[k]];
+                const double left = farmer.deadline > 0 ? std::max(0.001, farmer.deadline - elapsed) : horizon;
+                const int target = std::max(farmer.difficulty, farmer.job->best ? farmer.job->bestZeros.load() + 1 : 0);
+                need.push_back(std::pow(16.0, target) / left);
+                order[k] = k;
+            }
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                double da = farmers[active[a]].deadline, db = farmers[active[b]].deadline;
+                return (da > 0 ? da : HUGE_VAL) < (db > 0 ? db : HUGE_VAL);
+            });
+            const double perWorker = hashes > 0 ? hashes / (elapsed * workers) : HUGE_VAL;
+            std::vector<size_t> shares = allocateWorkers(need, order, perWorker, workers);
+
+            // Keep workers on their farmer where possible and move only the surplus.
+            std::vector<size_t> target(farmers.size(), 0), have(farmers.size(), 0);
+            for (size_t k = 0; k < active.size(); ++k) {
+                target[active[k]] = shares[k];
+            }
+            std::vector<size_t> idle;
+            for (size_t i = 0; i < workers; ++i) {
+                const int f = assignment[i].load();
+                if (f >= 0 && have[f] < target[f]) {
+                    have[f]++;
+                } else {
+                    idle.push_back(i);
+                }
+            }
+            size_t next = 0;
+            for (size_t f = 0; f < farmers.size(); ++f) {
+                for (; have[f] < target[f] && next < idle.size(); have[f]++) {
+                    assignment[idle[next++]].store(static_cast<int>(f));
+                }
+            }
+            for (; next < idle.size(); ++next) {
+                assignment[idle[next]].store(-1);
+            }
+            if (verbose && target != lastShares) {
+                std::cout << "[CPU] Workers:";
+                for (size_t f : active) {
+                    std::cout << " " << farmers[f].address.substr(0, 6) << "(" << farmers[f].difficulty << ")=" << target[f];
+                }
+                std::cout << std::endl;
+                lastShares = target;
+            }
+        }
+        const int seen = events.load();
+        wake.wait_for(lock, std::chrono::milliseconds(rebalanceInterval), [&]() { return events.load() != seen; });
+    }
+    lock.unlock();
+    done.store(true);
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+#if !defined(_WIN32)
+// Client of a --coordinator: mines the leases it hands out for one (block, hash, miner) on the
+// daemon worker pool, requesting the next lease once half of the current one is searched so the
+// workers do not wait. The searched prefix of the current lease (tracked by an in-memory journal)
+// is reported every quarter of the lease time, which renews the lease. Solutions reach the
+// coordinator through the job channel (writeSolution); a solution found elsewhere in the fleet
+// stops the current lease. Errors about a stale lease are only logged. Returns the verified
+// result, or false when the coordinator goes away or refuses a lease.
+bool mineLeases(const std::string& endpoint, std::uint32_t block, const std::string& hash, std::uint64_t nonce,
+    int difficulty, const std::string& miner, size_t workers, const std::vector<CpuInfo>& placement,
+    const KeccakBackend& keccak, std::uint64_t batchSize, RateBalancer* tuner, bool verbose, std::pair<std::vector<std::uint8_t>, std::uint64_t>& result) {
+    auto channel = std::make_shared<LineChannel>(connectEndpoint(endpoint));
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::map<std::string, std::string>> granted;
+    std::uint64_t solvedNonce = 0;
+    bool solvedElsewhere = false, closed = false, rejected = false;
+    std::thread reader([&]() {
+        std::string line;
+        while (channel->readLine(line)) {
+            std::map<std::string, std::string> fields;
+            if (!parseJsonObject(line, fields)) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (fields["event"] == "lease") {
+                granted.push_back(fields);
+            } else if (fields["event"] == "solved") {
+                solvedElsewhere = true;
+                solvedNonce = std::stoull(fields["nonce"]);
+            } else if (fields["event"] == "error") {
+                std::cerr << "[Fleet] Coordinator: " << fields["message"] << std::endl;
+                // Only the lease request has a reply to wait for.
+                rejected = rejected || fields["op"] == "lease";
+            }
+            changed.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        changed.notify_all();
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    double ttl = defaultLeaseSeconds;
+    auto request = [&]() {
+        // Sized from the measured rate to finish well before the lease expires.
+        const double elapsed = secondsSince(start), hashes = static_cast<double>(metrics.totalHashes());
+        const std::uint64_t count = std::max(batchSize * workers,
+            elapsed > 1 ? static_cast<std::uint64_t>(hashes / elapsed * ttl / 4) : 0);
+        channel->writeLine("{\"op\":\"lease\",\"block\":" + std::to_string(block) + ",\"hash\":" + jsonQuote(hash)
+            + ",\"miner\":" + jsonQuote(miner) + ",\"difficulty\":" + std::to_string(difficulty)
+            + ",\"nonce\":" + std::to_string(nonce) + ",\"count\":" + std::to_string(count) + "}");
+    };
+
+    auto engine = std::make_unique<MiningEngine>(workers, placement, keccak, writeSolution);
+    std::shared_ptr<MiningJob> current;
+    std::uint64_t leased = 0, leaseStart = 0;
+    auto reported = std::chrono::steady_clock::now();
+    bool pending = true, solved = false;
+    request();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait_for(lock, std::chrono::milliseconds(rebalanceInterval));
+        if (current && current->solved.load()) {
+            result = {current->digest, current->nonce};
+            solved = true;
+            break;
+        }
+        if (solvedElsewhere || closed || rejected) {
+            break;
+        }
+        if (current && current->hashes.load() >= leased) {
+            // Every nonce of the lease is hashed exactly once, so the count covers the whole lease.
+            channel->writeLine("{\"op\":\"done\",\"id\":" + jsonQuote(current->id) + ",\"searched\":"
+                + std::to_string(leased) + "}");
+            current.reset();
+        }
+        if (!current && !granted.empty()) {
+            auto fields = granted.front();
+            granted.pop_front();
+            pending = false;
+            const std::uint64_t begin = std::stoull(fields["start"]);
+            leased = std::stoull(fields["count"]);
+            leaseStart = begin;
+            reported = std::chrono::steady_clock::now();
+            ttl = std::stod(fields["ttl"]);
+            // The journal has a range per worker; larger pools only renew their leases.
+            std::shared_ptr<NonceJournal> journal;
+            if (workers <= NonceJournal::capacity) {
+                journal = std::make_shared<NonceJournal>();
+                journal->cursor.store(begin);
+                journal->zeros.store(-1);
+            }
+            current = makeJob(JobTemplate(block, begin, hash, miner), difficulty, workers, batchSize, hashRateInterval,
+                nullptr, begin + leased, journal);
+            current->id = fields["id"];
+            current->channel = channel;
+            current->tuner = tuner;
+            if (verbose) {
+                std::cout << "[Fleet] Lease " << current->id << ": nonces " << begin << "+" << leased << std::endl;
+            }
+            engine->publish(current);
+        }
+        if (current && secondsSince(reported) >= ttl / 4) {
+            reported = std::chrono::steady_clock::now();
+            channel->writeLine("{\"op\":\"progress\",\"id\":" + jsonQuote(current->id) + ",\"searched\":"
+                + std::to_string(current->journal ? current->journal->searched() - leaseStart : 0) + "}");
+        }
+        if (!pending && (!current || current->hashes.load() >= leased / 2)) {
+            pending = true;
+            lock.unlock();
+            request();
+            lock.lock();
+        }
+    }
+    lock.unlock();
+    engine.reset();
+    channel->hangUp();
+    reader.join();
+    if (solved || !solvedElsewhere) {
+        return solved;
+    }
+    // Announced by the coordinator, which verified it; the digest is recomputed locally.
+    auto job = makeJob(block, hash, nonce, difficulty, miner, 1, batchSize, hashRateInterval);
+    Digest digest;
+    job->engine.digest(solvedNonce, digest.data());
+    result = {std::vector<std::uint8_t>(digest.begin(), digest.end()), solvedNonce};
+    return job->meets(digest.data());
+}
+#endif
+
+#if GPU == GPU_OPENCL
+// Mines `job` on the OpenCL `devices` and, with `cpuWorkers`, on the CPU pool at the same time.
+// Everyone takes ranges from the job's nonce cursor: CPU workers through their leases, devices
+// through RateBalancer-sized claims. The first verified result stops every device within one
+// batch. With a checkpoint journal, each device journals its claims in `depth` journal ranges
+// and marks them searched as their batches complete. Metrics slots: the CPU workers first, then
+// one per device. With a tune `profile`, a device without an entry first runs a few live batches
+// per work-group size and keeps the fastest; its tuned values are written back to the profile at
+// the end.
+void mineDevices(MiningJob& job, const std::vector<int>& devices, size_t cpuWorkers, const std::vector<CpuInfo>& placement,
+    const KeccakBackend* keccak, const std::vector<std::uint8_t>& data, size_t nonceOffset, std::uint64_t batchSize,
+    int threadsPerBlock, int depth, double target, TuneProfile* profile, bool verbose) {
+    RateBalancer balancer(devices.size(), batchSize, target, static_cast<std::uint64_t>(threadsPerBlock));
+    std::vector<std::vector<size_t>> records;
+    for (size_t d = 0; d < devices.size(); ++d) {
+        records.push_back(job.scheduler.reserve(static_cast<size_t>(std::max(1, depth))));
+    }
+    std::atomic<size_t> running(devices.size() + cpuWorkers);
+    auto cpu = startWorkers(cpuWorkers, placement, [&](size_t i) {
+        find(i, job, *keccak, verbose, []() { return false; });
+        running--;
+    });
+
+    struct Device {
+        MiningJob* job;
+        RateBalancer* balancer;
+        size_t index;
+        size_t slot;
+        // Journal ranges of the batches in flight (empty without a checkpoint).
+        const std::vector<size_t>* records;
+        bool measured;
+        // Work-group calibration (--auto-tune): the size of the running pipeline.
+        WorkGroupTuner* tuner;
+        int localSize;
+    };
+    std::vector<std::thread> threads;
+    for (size_t d = 0; d < devices.size(); ++d) {
+        threads.emplace_back([&, d]() {
+            TRACE_THREAD("gpu " + std::to_string(devices[d]));
+            Device device{&job, &balancer, d, cpuWorkers + d, &records[d], false, nullptr, threadsPerBlock};
+            std::vector<std::uint8_t> input = data;
+            std::uint8_t output[32];
+            std::uint64_t validNonce = 0;
+            // A calibration pipeline ends once the tuner moves on to the next size.
+            auto nextRange = [](std::uint64_t* nonce, std::uint64_t* count, void* user) {
+                auto& device = *static_cast<Device*>(user);
+                return !device.job->stop.load(std::memory_order_relaxed)
+                    && (!device.tuner || device.tuner->current() == device.localSize)
+                    && device.job->scheduler.claim(device.balancer->size(device.index), *nonce, *count, *device.records);
+            };
+            auto completed = [](std::uint64_t nonce, std::uint64_t count, double seconds, void* user) {
+                auto& device = *static_cast<Device*>(user);
+                device.job->scheduler.complete(*device.records, nonce, count);
+                metrics.addHashes(device.slot, count);
+                metrics.observeBatch(device.slot, seconds);
+                device.job->hashes.fetch_add(count, std::memory_order_relaxed);
+                // The first batch includes the kernel build.
+                if (device.measured) {
+                    device.balancer->observe(device.index, count, seconds);
+                    if (device.tuner && device.tuner->current() == device.localSize) {
+                        device.tuner->observe(count, seconds);
+                    }
+                }
+                device.measured = true;
+            };
+            // A stopped job skips the queued batches; a calibration size change drains them.
+            auto stopped = [](void* user) {
+                return static_cast<Device*>(user)->job->stop.load(std::memory_order_relaxed);
+            };
+            auto run = [&]() {
+                return executePipeline(devices[d], input.data(), static_cast<int>(input.size()), static_cast<int>(nonceOffset),
+                    job.difficulty, device.localSize, depth, output, &validNonce, verbose && !device.measured,
+                    nextRange, completed, stopped, &device);
+            };
+            std::string key;
+            int res = 0;
+            if (profile) {
+                char name[256] = {};
+                openclDeviceName(devices[d], name, sizeof(name));
+                key = hostName() + "/" + name;
+                TuneEntry entry;
+                if (profile->lookup(key, entry)) {
+                    device.localSize = entry.localSize;
+                    balancer.seed(d, entry.rate);
+                } else {
+                    WorkGroupTuner tuner(openclWorkGroupLimit(devices[d]));
+                    device.tuner = &tuner;
+                    while (res == 0 && !tuner.done() && !job.stop.load()) {
+                        device.localSize = tuner.current();
+                        res = run();
+                        if (res == 0 && tuner.current() == device.localSize) {
+                            break;  // Stopped or out of range before the size was measured.
+                        }
+                    }
+                    device.tuner = nullptr;
+                    device.localSize = tuner.best();
+                }
+                if (verbose) {
+                    std::cout << "[GPU] Device " << devices[d] << ": work-group size " << device.localSize << std::endl;
+                }
+            }
+            if (res == 0) {
+                res = run();
+            }
+            if (profile && balancer.rate(d) > 0) {
+                profile->update(key, {balancer.size(d), device.localSize, balancer.rate(d)});
+            }
+            Digest digest;
+            job.engine.digest(validNonce, digest.data());
+            bool expected = false;
+            if (res == 1 && job.meets(digest.data()) && job.solved.compare_exchange_strong(expected, true)) {
+                job.digest.assign(digest.begin(), digest.end());
+                job.nonce = validNonce;
+                record(job);
+                job.stop.store(true);
+                metrics.observeFirstSolution(secondsSince(job.created));
+            } else if (res < 0) {
+                std::cerr << "[GPU] Device " << devices[d] << " failed." << std::endl;
+            }
+            running--;
+        });
+    }
+
+    auto reported = std::chrono::steady_clock::now();
+    while (!job.stop.load() && running.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(rebalanceInterval));
+        if (verbose && secondsSince(reported) * 1000 >= hashRateInterval) {
+            reported = std::chrono::steady_clock::now();
+            for (size_t d = 0; d < devices.size(); ++d) {
+                std::cout << "[GPU] Device " << devices[d] << ": " << formatHashRate(balancer.rate(d))
+                          << ", range " << balancer.size(d) << std::endl;
+            }
+        }
+    }
+    // Every worker has stopped, or one of them found the result.
+    job.stop.store(true);
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (auto& t : cpu) {
+        t.join();
+    }
+}
+#endif
+
 int main(int argc, char* argv[]) {
-    if (argc < 6) {
+    const bool daemon = argc > 1 && std::strcmp(argv[1], "--daemon") == 0;
+    const bool coordinator = argc > 2 && std::strcmp(argv[1], "--coordinator") == 0;
+    if (argc < 6 && !daemon && !coordinator) {
         std::cerr << "Usage: " << argv[0]
                   << " <block> <hash> <nonce> <difficulty> <miner_address>\n"
                   << "  [--max-threads <num> (default: " << defaultMaxThreads << ")]\n"
                   << "  [--batch-size <num> (default: " << defaultBatchSize << ")]\n"
-                  << "  [--device <num> (default 0)] [--verbose]\n";
+                  << "  [--affinity <core|logical>] [--device <num|all> (default 0)] [--hybrid [--cpu-threads <num>]] [--pipeline <depth> (default: " << defaultPipelineDepth << ")] [--cl-kernel <generic|job|vector|best>] [--keccak <name|auto> (default: " << KECCAK_DEFAULT << ")]\n"
+                  << "  [--farmer <address>[:<difficulty>[:<deadline seconds>]] ...] [--deadline <seconds>] [--checkpoint <file>] [--metrics <port|file>] [--trace <file>]\n"
+                  << "  [--auto-tune [--tune-target <ms>]] [--join <host:port|path>] [--verbose]\n"
+                  << "   or: " << argv[0] << " --daemon [--socket <path>] [options]\n"
+                  << "   or: " << argv[0] << " --coordinator <host:port|path> [--lease-seconds <num> (default: " << defaultLeaseSeconds << ")] [--verbose]\n";
         return 1;
     }
 
-    int64_t block = std::stoll(argv[1]);
-    std::string hash = argv[2];
-    int64_t nonce = std::stoll(argv[3]);
-    int difficulty = std::stoi(argv[4]);
-    std::string miner = argv[5];
+    const bool service = daemon || coordinator;
+    int64_t block = service ? 0 : std::stoll(argv[1]);
+    std::string hash = service ? "" : argv[2];
+    int64_t nonce = service ? 0 : std::stoll(argv[3]);
+    int difficulty = service ? 0 : std::stoi(argv[4]);
+    std::string miner = service ? "" : argv[5];
+    std::string socketPath;
+    std::string joinEndpoint;
+    double leaseSeconds = defaultLeaseSeconds;
+    std::string checkpointPath;
+    std::string metricsTarget;
+    std::string tracePath;
+    std::vector<std::string> farmerSpecs;
+    double deadline = 0;
 
     bool verbose = false;
     bool gpu = false;
     int deviceId = 0;
+    bool allDevices = false;
+    bool hybrid = false;
+    int cpuThreads = 0;
     std::uint64_t batchSize = defaultBatchSize;
-    int maxThreads = defaultMaxThreads;
-    for (int i = 6; i < argc; ++i) {
+    int maxThreads = 0;
+#if GPU == GPU_OPENCL
+    int pipelineDepth = defaultPipelineDepth;
+#endif
+    std::string clKernel = "generic";
+    Affinity affinity = Affinity::None;
+    std::string keccakName = KECCAK_DEFAULT;
+    bool autoTune = false;
+    double tuneTarget = 0;
+    for (int i = daemon ? 2 : coordinator ? 3 : 6; i < argc; ++i) {
         if (std::strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) {
             maxThreads = std::stoi(argv[++i]);
         } else if (std::strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc) {
             batchSize = std::stoll(argv[++i]);
         } else if (std::strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
-            deviceId = std::stoi(argv[++i]);
-        }  else if (std::strcmp(argv[i], "--verbose") == 0) {
+            const std::string device = argv[++i];
+            allDevices = device == "all";
+            deviceId = allDevices ? 0 : std::stoi(device);
+        } else if (std::strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+        #if GPU == GPU_OPENCL
+            pipelineDepth = std::max(1, std::stoi(argv[++i]));
+        #else
+            std::cerr << "--pipeline requires an OpenCL build.\n";
+            return 1;
+        #endif
+        } else if (std::strcmp(argv[i], "--cl-kernel") == 0 && i + 1 < argc) {
+            clKernel = argv[++i];
+        } else if (std::strcmp(argv[i], "--affinity") == 0 && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode != "core" && mode != "logical") {
+                std::cerr << "Unknown affinity mode '" << mode << "' (expected core or logical).\n";
+                return 1;
+            }
+            affinity = mode == "core" ? Affinity::Core : Affinity::Logical;
+        } else if (std::strcmp(argv[i], "--deadline") == 0 && i + 1 < argc) {
+            deadline = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "--farmer") == 0 && i + 1 < argc) {
+            farmerSpecs.push_back(argv[++i]);
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+        #if defined(TRACE) && TRACE
+            tracePath = argv[++i];
+        #else
+            std::cerr << "Tracing not enabled in this build (make TRACE=1).\n";
+            return 1;
+        #endif
+        } else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsTarget = argv[++i];
+        } else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpointPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--keccak") == 0 && i + 1 < argc) {
+            keccakName = argv[++i];
+        } else if (std::strcmp(argv[i], "--hybrid") == 0) {
+            hybrid = true;
+        } else if (std::strcmp(argv[i], "--cpu-threads") == 0 && i + 1 < argc) {
+            cpuThreads = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--join") == 0 && i + 1 < argc) {
+            joinEndpoint = argv[++i];
+        } else if (std::strcmp(argv[i], "--lease-seconds") == 0 && i + 1 < argc) {
+            leaseSeconds = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "--auto-tune") == 0) {
+            autoTune = true;
+        } else if (std::strcmp(argv[i], "--tune-target") == 0 && i + 1 < argc) {
+            tuneTarget = std::stod(argv[++i]) / 1000;
+        } else if (std::strcmp(argv[i], "--verbose") == 0) {
             verbose = true;
         } else if (std::strcmp(argv[i], "--gpu") == 0) {
         #if GPU == GPU_CUDA || GPU == GPU_OPENCL
@@ -183,6 +712,238 @@ int main(int argc, char* argv[]) {
         }
     }
 
+#if defined(TRACE) && TRACE
+    // Declared first so the trace is written after every worker has been joined.
+    TraceOutput traceOutput{tracePath};
+    TRACE_THREAD("main");
+#endif
+
+    if (coordinator) {
+    #if defined(_WIN32)
+        std::cerr << "Coordinator mode is not supported on this platform.\n";
+        return 1;
+    #else
+        try {
+            NonceCoordinator leases(leaseSeconds, maxLeaseSize, verbose);
+            int server = listenEndpoint(argv[2], 64);
+            if (verbose) {
+                std::cerr << "[Coordinator] Listening on " << argv[2] << std::endl;
+            }
+            while (true) {
+                int client = accept(server, nullptr, nullptr);
+                if (client < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error("Failed to accept connection.");
+                }
+                std::thread([&leases, client]() { leases.serve(std::make_shared<LineChannel>(client)); }).detach();
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Exception: " << e.what() << std::endl;
+            return 1;
+        }
+    #endif
+    }
+    if (!joinEndpoint.empty() && (gpu || daemon || !farmerSpecs.empty() || deadline > 0 || !checkpointPath.empty())) {
+        std::cerr << "--join mines one farmer on the CPU (no --gpu, --daemon, --farmer, --deadline or --checkpoint).\n";
+        return 1;
+    }
+    if (gpu && !farmerSpecs.empty()) {
+        std::cerr << "--farmer mines on the CPU (no --gpu).\n";
+        return 1;
+    }
+    if (gpu && deadline > 0) {
+        std::cerr << "--deadline (best-so-far mode) mines on the CPU (no --gpu).\n";
+        return 1;
+    }
+
+#if GPU == GPU_OPENCL
+    if (!selectOpenCLKernel(clKernel.c_str())) {
+        std::cerr << "Unknown OpenCL kernel '" << clKernel << "' (expected generic, job, vector or best).\n";
+        return 1;
+    }
+#else
+    if (allDevices || hybrid) {
+        std::cerr << "--device all and --hybrid require an OpenCL build.\n";
+        return 1;
+    }
+#endif
+    hybrid = hybrid && gpu;
+#if GPU == GPU_CUDA
+    if (gpu && !checkpointPath.empty()) {
+        std::cerr << "--checkpoint is not supported on CUDA devices.\n";
+        return 1;
+    }
+#endif
+
+    const KeccakBackend* keccak = nullptr;
+    if (!gpu || hybrid) {
+        keccak = selectKeccakBackend(keccakName, verbose && !daemon);
+        if (!keccak) {
+            std::cerr << "Keccak backend '" << keccakName << "' is not available. Supported: auto";
+            for (const auto& backend : keccakBackends()) {
+                if (backend.supported()) {
+                    std::cerr << ", " << backend.name;
+                }
+            }
+            std::cerr << "\n";
+            return 1;
+        }
+        if (verbose) {
+            (daemon ? std::cerr : std::cout) << "[CPU] Keccak backend: " << keccak->name << std::endl;
+        }
+    }
+
+    std::vector<CpuInfo> placement;
+    if (affinity != Affinity::None && (!gpu || hybrid)) {
+        placement = placeWorkers(readTopology(), affinity);
+        if (placement.empty()) {
+            std::cerr << "CPU topology not available on this platform, affinity disabled.\n";
+        }
+    }
+    if (maxThreads <= 0) {
+        maxThreads = placement.empty() ? defaultMaxThreads : static_cast<int>(placement.size());
+    }
+    // With --hybrid, --max-threads stays the GPU threads per block and --cpu-threads sizes the CPU pool.
+    if (cpuThreads <= 0) {
+        cpuThreads = placement.empty() ? defaultMaxThreads : static_cast<int>(placement.size());
+    }
+    const size_t workers = static_cast<size_t>(std::max(1, hybrid ? cpuThreads : maxThreads));
+
+    // Metrics slots: CPU workers first, then one per device.
+    std::vector<std::string> slots(!gpu || hybrid ? workers : 0, "cpu");
+    std::vector<int> devices;
+    if (gpu) {
+    #if GPU == GPU_OPENCL
+        const int available = openclDeviceCount();
+        for (int d = allDevices ? 0 : deviceId; d < (allDevices ? available : std::min(deviceId + 1, available)); ++d) {
+            devices.push_back(d);
+        }
+        if (devices.empty()) {
+            std::cerr << "No OpenCL device " << (allDevices ? std::string("found") : std::to_string(deviceId)) << ".\n";
+            return 1;
+        }
+    #else
+        devices.push_back(deviceId);
+    #endif
+        for (int d : devices) {
+            slots.push_back("gpu" + std::to_string(d));
+        }
+    }
+    metrics.init(slots);
+    std::unique_ptr<MetricsExporter> exporter;
+    if (!metricsTarget.empty()) {
+        try {
+            exporter = std::make_unique<MetricsExporter>(metrics, metricsTarget);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // --auto-tune: CPU chunks follow each worker's measured rate, starting from the saved profile.
+    std::unique_ptr<TuneProfile> profile;
+    std::unique_ptr<RateBalancer> cpuTuner;
+    const std::string cpuKey = hostName() + "/cpu " + (keccak ? keccak->name : "");
+    if (autoTune) {
+        profile = std::make_unique<TuneProfile>(tuneProfilePath());
+        if (keccak) {
+            cpuTuner = std::make_unique<RateBalancer>(workers, daemon ? preemptInterval : hashRateInterval,
+                tuneTarget > 0 ? tuneTarget : cpuChunkSeconds, cpuChunkGranularity);
+            TuneEntry entry;
+            if (profile->lookup(cpuKey, entry)) {
+                for (size_t i = 0; i < workers; ++i) {
+                    cpuTuner->seed(i, entry.rate);
+                }
+            }
+        }
+    }
+    auto saveProfile = [&]() {
+        if (!profile) {
+            return;
+        }
+        if (cpuTuner) {
+            TuneEntry entry;
+            for (size_t i = 0; i < workers; ++i) {
+                entry.size += cpuTuner->size(i) / workers;
+                entry.rate += cpuTuner->rate(i) / workers;
+            }
+            if (entry.rate > 0) {
+                profile->update(cpuKey, entry);
+                if (verbose) {
+                    (daemon ? std::cerr : std::cout) << "[CPU] Tuned chunk: " << entry.size << " nonces ("
+                        << formatHashRate(entry.rate) << " per worker)" << std::endl;
+                }
+            }
+        }
+        if (!profile->save()) {
+            std::cerr << "Failed to save tune profile " << profile->path().string() << "\n";
+        }
+    };
+
+    std::unique_ptr<Checkpoint> checkpoint;
+    if (!checkpointPath.empty()) {
+        try {
+            checkpoint = std::make_unique<Checkpoint>(checkpointPath);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (daemon) {
+        if (gpu) {
+            std::cerr << "Daemon mode is CPU-only.\n";
+            return 1;
+        }
+        reportPlacement(std::cerr, placement, workers);
+        auto engine = std::make_unique<MiningEngine>(workers, placement, *keccak, writeSolution);
+        try {
+            if (socketPath.empty()) {
+                serveJobs(std::make_shared<LineChannel>(), *engine, workers, batchSize, checkpoint.get(), cpuTuner.get());
+            } else {
+            #if defined(_WIN32)
+                throw std::runtime_error("Unix sockets are not supported on this platform.");
+            #else
+                int server = listenUnixSocket(socketPath);
+                if (verbose) {
+                    std::cerr << "[CPU] Daemon listening on " << socketPath << std::endl;
+                }
+                while (true) {
+                    int client = accept(server, nullptr, nullptr);
+                    if (client < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw std::runtime_error("Failed to accept connection.");
+                    }
+                    serveJobs(std::make_shared<LineChannel>(client), *engine, workers, batchSize, checkpoint.get(), cpuTuner.get());
+                }
+            #endif
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Exception: " << e.what() << std::endl;
+        }
+        engine.reset();
+        saveProfile();
+        return 0;
+    }
+
+    std::vector<Farmer> farmers;
+    try {
+        farmers.push_back(parseFarmer(miner, difficulty));
+        for (const auto& spec : farmerSpecs) {
+            farmers.push_back(parseFarmer(spec, difficulty));
+        }
+        for (const auto& farmer : farmers) {
+            difficultyCheck(farmer.difficulty);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid farmer: " << e.what() << std::endl;
+        return 1;
+    }
+
     try {
         std::thread monitorThread([=]() { monitorHashRate(verbose, gpu); });
         std::pair<std::vector<std::uint8_t>, std::uint64_t> result;
@@ -192,29 +953,89 @@ int main(int argc, char* argv[]) {
             #elif GPU == GPU_OPENCL
                 std::cout << "[GPU] OpenCL" << std::endl;
             #endif
-            #if GPU == GPU_CUDA || GPU == GPU_OPENCL
-            std::uint64_t currentNonce = nonce;
+            #if GPU == GPU_OPENCL
+            if (verbose) {
+                for (int d : devices) {
+                    char name[256] = {};
+                    openclDeviceName(d, name, sizeof(name));
+                    std::cout << "[GPU] Device " << d << ": " << name << std::endl;
+                }
+                reportPlacement(std::cout, placement, hybrid ? workers : 0);
+            }
+            const size_t cpuWorkers = hybrid ? workers : 0;
+            auto job = makeJob(block, hash, nonce, difficulty, miner, cpuWorkers, batchSize, hashRateInterval, checkpoint.get());
+            job->tuner = cpuTuner.get();
+            if (job->resumed && verbose) {
+                std::cout << "[GPU] Resuming from checkpoint at nonce " << job->journal->cursor.load() << std::endl;
+            }
+            restoreResult(*job);
+            size_t nonceOffset = 0;
+            const std::vector<std::uint8_t> data = prepare(block, nonce, hash, miner, nonceOffset);
+            mineDevices(*job, devices, cpuWorkers, placement, keccak, data, nonceOffset, batchSize, maxThreads, pipelineDepth,
+                tuneTarget > 0 ? tuneTarget : deviceBatchSeconds, profile.get(), verbose);
+            found.store(true);
+            saveProfile();
+            if (job->solved.load()) {
+                result = {job->digest, job->nonce};
+            }
+            #elif GPU == GPU_CUDA
             bool showDeviceInfo = verbose;
+            const auto gpuStart = std::chrono::steady_clock::now();
+            std::uint64_t currentNonce = nonce;
+            // --auto-tune: batches follow the measured rate, and without a profile entry the
+            // threads per block are calibrated on the first batches.
+            RateBalancer tuner(1, batchSize, tuneTarget > 0 ? tuneTarget : deviceBatchSeconds, static_cast<std::uint64_t>(maxThreads));
+            std::unique_ptr<WorkGroupTuner> workGroups;
+            int threadsPerBlock = maxThreads;
+            std::string key;
+            if (profile) {
+                cudaDeviceProp properties = {};
+                const bool known = cudaGetDeviceProperties(&properties, deviceId) == cudaSuccess;
+                key = hostName() + "/" + (known ? properties.name : "cuda " + std::to_string(deviceId));
+                TuneEntry entry;
+                if (profile->lookup(key, entry)) {
+                    threadsPerBlock = entry.localSize;
+                    tuner.seed(0, entry.rate);
+                } else {
+                    workGroups = std::make_unique<WorkGroupTuner>(known ? properties.maxThreadsPerBlock : maxThreads);
+                }
+            }
             while (!found.load()) {
+                if (profile) {
+                    batchSize = tuner.size(0);
+                    threadsPerBlock = workGroups && !workGroups->done() ? workGroups->current() : threadsPerBlock;
+                }
                 size_t nonceOffset = 0;
                 std::vector<std::uint8_t> data = prepare(block, currentNonce, hash, miner, nonceOffset);
-                std::vector<std::uint8_t> input(data.size());
-                std::memcpy(input.data(), data.data(), data.size());
                 std::vector<std::uint8_t> output(32);
                 std::uint64_t validNonce = 0;
                 if (verbose) {
-                    std::cout << "[GPU] Mining batch: " << nonce << " block: " << block
+                    std::cout << "[GPU] Mining batch: " << currentNonce << " block: " << block
                               << " difficulty: " << difficulty << " hash: " << hash << std::endl;
                     std::cout.flush();
                 }
-                auto gpuStartTime = std::chrono::high_resolution_clock::now();
-                int res = executeKernel(deviceId, input.data(), data.size(), currentNonce, nonceOffset,
-                                             batchSize, difficulty, maxThreads, output.data(), &validNonce, showDeviceInfo);
+                const auto gpuStartTime = std::chrono::steady_clock::now();
+                int res;
+                {
+                    TRACE_SPAN("batch", currentNonce);
+                    res = executeKernel(deviceId, data.data(), data.size(), currentNonce, nonceOffset,
+                                        batchSize, difficulty, threadsPerBlock, output.data(), &validNonce, showDeviceInfo);
+                }
+                const double seconds = secondsSince(gpuStartTime);
+                // The first batch includes the device setup.
+                if (profile && currentNonce != static_cast<std::uint64_t>(nonce)) {
+                    tuner.observe(0, batchSize, seconds);
+                    if (workGroups && !workGroups->done()) {
+                        workGroups->observe(batchSize, seconds);
+                        threadsPerBlock = workGroups->done() ? workGroups->best() : threadsPerBlock;
+                    }
+                }
                 showDeviceInfo = false;
-                auto gpuEndTime = std::chrono::high_resolution_clock::now();
-                std::chrono::duration<double> elapsedTime = gpuEndTime - gpuStartTime;
-                hashMetric.store(batchSize / elapsedTime.count());
+                hashMetric.store(batchSize / seconds);
+                metrics.addHashes(0, batchSize);
+                metrics.observeBatch(0, seconds);
                 if (res == 1) {
+                    metrics.observeFirstSolution(secondsSince(gpuStart));
                     found.store(true);
                     result.first.assign(output.begin(), output.end());
                     result.second = validNonce;
@@ -222,38 +1043,88 @@ int main(int argc, char* argv[]) {
                 }
                 currentNonce += batchSize;
             }
+            if (profile && tuner.rate(0) > 0) {
+                profile->update(key, {tuner.size(0), workGroups ? workGroups->best() : threadsPerBlock, tuner.rate(0)});
+            }
+            saveProfile();
             #endif
+        } else if (!joinEndpoint.empty()) {
+        #if defined(_WIN32)
+            throw std::runtime_error("--join is not supported on this platform.");
+        #else
+            if (verbose) {
+                std::cout << "[Fleet] Mining block: " << block << " hash: " << hash << " threads: " << workers
+                          << " coordinator: " << joinEndpoint << std::endl;
+            }
+            reportPlacement(std::cout, placement, workers);
+            if (!mineLeases(joinEndpoint, block, hash, nonce, difficulty, miner, workers, placement, *keccak, batchSize,
+                cpuTuner.get(), verbose, result)) {
+                result.first.clear();
+            }
+            found.store(true);
+            saveProfile();
+        #endif
         } else {
-            std::uint64_t currentNonce = nonce;
-            std::vector<std::thread> threads;
-            std::mutex resultMutex;
-            while (!found.load()) {
-                while (static_cast<int>(threads.size()) < maxThreads && !found.load()) {
-                    std::uint64_t endNonce = currentNonce + batchSize;
-                    threads.emplace_back([&, startNonce = currentNonce, endNonce]() {
-                        auto localResult = find(block, hash, startNonce, difficulty, miner, verbose, batchSize);
-                        if (!localResult.first.empty()) {
-                            std::lock_guard<std::mutex> lock(resultMutex);
-                            result = localResult;
-                            found.store(true);
-                        }
-                    });
-                    currentNonce = endNonce;
+            // Entropy and block are decoded once; only the miner key differs between jobs.
+            const auto start = std::chrono::steady_clock::now();
+            std::mutex outputMutex;
+            JobTemplate shared(block, nonce, hash, farmers.front().address);
+            for (auto& farmer : farmers) {
+                shared.setMiner(farmer.address);
+                farmer.job = makeJob(shared, farmer.difficulty, workers, batchSize, hashRateInterval, checkpoint.get());
+                farmer.job->tuner = cpuTuner.get();
+                if (farmer.job->resumed && verbose) {
+                    std::cout << "[CPU] Resuming " << farmer.address << " from checkpoint at nonce "
+                              << farmer.job->journal->cursor.load() << std::endl;
+                }
+                if (deadline > 0) {
+                    farmer.deadline = farmer.deadline > 0 ? farmer.deadline : deadline;
+                    farmer.job->best = true;
+                    farmer.job->improved = [&, address = farmer.address](const MiningJob& job) {
+                        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                        std::lock_guard<std::mutex> lock(outputMutex);
+                        std::cout << "{\"event\": \"improved\", \"miner\": " << jsonQuote(address) << ", \"zeros\": " << job.recordedZeros
+                                  << ", \"hash\": \"" << toHex(job.digest) << "\", \"nonce\": " << job.nonce
+                                  << ", \"elapsed\": " << std::fixed << std::setprecision(3) << elapsed << "}" << std::endl;
+                    };
                 }
-                threads.erase(std::remove_if(threads.begin(), threads.end(),
-                    [](std::thread& t) {
-                        if (t.joinable()) {
-                            t.join();
-                            return true;
-                        }
-                        return false;
-                    }), threads.end());
             }
-
-            for (auto& t : threads) {
-                if (t.joinable()) {
-                    t.join();
+            for (auto& farmer : farmers) {
+                restoreResult(*farmer.job);
+            }
+            if (deadline > 0) {
+                std::signal(SIGTERM, onTerminate);
+                std::signal(SIGINT, onTerminate);
+            }
+            if (verbose) {
+                std::cout << "[CPU] Mining block: " << block << " hash: " << hash << " threads: " << workers
+                          << " farmers: " << farmers.size() << std::endl;
+            }
+            reportPlacement(std::cout, placement, workers);
+            const bool multi = farmers.size() > 1;
+            mineFarmers(farmers, workers, placement, *keccak, verbose, [&](const Farmer& farmer) {
+                std::lock_guard<std::mutex> best(farmer.job->bestMutex);
+                if (!multi) {
+                    if (farmer.job->solved.load()) {
+                        result = {farmer.job->digest, farmer.job->nonce};
+                    }
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cout << "{\"miner\": " << jsonQuote(farmer.address) << ", \"difficulty\": " << farmer.difficulty;
+                if (farmer.job->solved.load()) {
+                    std::cout << ", \"hash\": \"" << toHex(farmer.job->digest) << "\", \"nonce\": " << farmer.job->nonce;
+                } else {
+                    std::cout << ", \"error\": " << jsonQuote(terminated.load() ? "Terminated."
+                        : farmer.deadline > 0 ? "Deadline reached." : "Nonce range exhausted.");
                 }
+                std::cout << ", \"hashes\": " << farmer.job->hashes.load() << "}" << std::endl;
+            });
+            found.store(true);
+            saveProfile();
+            if (multi) {
+                monitorThread.detach();
+                return 0;
             }
         }
 
@@ -0,0 +1,201 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Line-oriented duplex channel over stdin/stdout or a socket connection (Unix domain or TCP).
+    Writes are serialized so workers can stream results concurrently.
+*/
+
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#if !defined(_WIN32)
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+class LineChannel {
+    public:
+        // Standard input/output.
+        LineChannel() = default;
+
+#if !defined(_WIN32)
+        // Connected socket, closed with the channel.
+        explicit LineChannel(int fd) : fd(fd) {}
+
+        ~LineChannel() {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+
+        LineChannel(const LineChannel&) = delete;
+        LineChannel& operator=(const LineChannel&) = delete;
+
+        bool readLine(std::string& line) {
+            if (fd < 0) {
+                return static_cast<bool>(std::getline(std::cin, line));
+            }
+#if !defined(_WIN32)
+            while (true) {
+                size_t end = buffer.find('\n');
+                if (end != std::string::npos) {
+                    line = buffer.substr(0, end);
+                    buffer.erase(0, end + 1);
+                    return true;
+                }
+                char chunk[4096];
+                ssize_t received = read(fd, chunk, sizeof(chunk));
+                if (received <= 0) {
+                    return false;
+                }
+                buffer.append(chunk, static_cast<size_t>(received));
+            }
+#else
+            return false;
+#endif
+        }
+
+        // Writes one line; returns false once the peer is gone.
+        bool writeLine(const std::string& line) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (fd < 0) {
+                std::cout << line << std::endl;
+                return static_cast<bool>(std::cout);
+            }
+#if !defined(_WIN32)
+            std::string data = line + "\n";
+            for (size_t sent = 0; sent < data.size();) {
+                ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    return false;
+                }
+                sent += static_cast<size_t>(n);
+            }
+#endif
+            return true;
+        }
+
+        // Ends a blocked readLine() from another thread (sockets only).
+        void hangUp() {
+#if !defined(_WIN32)
+            if (fd >= 0) {
+                shutdown(fd, SHUT_RDWR);
+            }
+#endif
+        }
+
+    private:
+        int fd = -1;
+        std::string buffer;
+        std::mutex mutex;
+};
+
+#if !defined(_WIN32)
+// Listening Unix domain socket at `path`, replacing a stale socket file.
+inline int listenUnixSocket(const std::string& path, int backlog = 1) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path too long.");
+    }
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, path.size());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create socket.");
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to listen on " + path + ".");
+    }
+    return fd;
+}
+
+// "<host>:<port>" names a TCP endpoint, anything else a Unix socket path.
+inline bool isTcpEndpoint(const std::string& endpoint) {
+    return endpoint.find('/') == std::string::npos && endpoint.rfind(':') != std::string::npos;
+}
+
+// Socket bound (listening) or connected to the first usable address of a TCP endpoint. An empty
+// host is loopback (127.0.0.1 when listening); every interface takes an explicit 0.0.0.0 or [::].
+inline int openTcpSocket(const std::string& endpoint, bool listening, int backlog) {
+    const size_t colon = endpoint.rfind(':');
+    std::string host = endpoint.substr(0, colon);
+    const std::string port = endpoint.substr(colon + 1);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    if (host.empty() && listening) {
+        host = "127.0.0.1";
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+        throw std::runtime_error("Failed to resolve " + endpoint + ".");
+    }
+    int fd = -1;
+    for (addrinfo* address = addresses; address && fd < 0; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        const int on = 1;
+        if (listening) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        } else {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        const bool ready = listening
+            ? bind(fd, address->ai_addr, address->ai_addrlen) == 0 && listen(fd, backlog) == 0
+            : connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+        if (!ready) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Failed to ") + (listening ? "listen on " : "connect to ") + endpoint + ".");
+    }
+    return fd;
+}
+
+inline int listenEndpoint(const std::string& endpoint, int backlog) {
+    return isTcpEndpoint(endpoint) ? openTcpSocket(endpoint, true, backlog) : listenUnixSocket(endpoint, backlog);
+}
+
+inline int connectEndpoint(const std::string& endpoint) {
+    if (isTcpEndpoint(endpoint)) {
+        return openTcpSocket(endpoint, false, 0);
+    }
+    sockaddr_un address{};
+    if (endpoint.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path too long.");
+    }
+    address.sun_family = AF_UNIX;
+    endpoint.copy(address.sun_path, endpoint.size());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw std::runtime_error("Failed to connect to " + endpoint + ".");
+    }
+    return fd;
+}
+#endif
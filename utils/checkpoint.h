@@ -0,0 +1,164 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Memory-mapped checkpoint file holding one NonceJournal per job (block, hash, miner,
+    difficulty). Workers update the mapping with plain atomic stores; the OS keeps it across a
+    process crash and a background thread schedules write-back every second for host restarts.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "scheduler.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+class Checkpoint {
+    public:
+        static constexpr size_t records = 64;
+
+        explicit Checkpoint(const std::string& path) {
+#if defined(_WIN32)
+            throw std::runtime_error("Checkpoints are not supported on this platform.");
+#else
+            fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd < 0 || ftruncate(fd, sizeof(Record) * records) != 0) {
+                throw std::runtime_error("Failed to open checkpoint " + path + ".");
+            }
+            void* mapped = mmap(nullptr, sizeof(Record) * records, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Failed to map checkpoint " + path + ".");
+            }
+            table = static_cast<Record*>(mapped);
+            flusher = std::thread([this]() {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (!stopping) {
+                    stopped.wait_for(lock, std::chrono::seconds(1));
+                    flush();
+                }
+            });
+#endif
+        }
+
+        ~Checkpoint() {
+#if !defined(_WIN32)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            stopped.notify_all();
+            flusher.join();
+            flush();
+            munmap(table, sizeof(Record) * records);
+            close(fd);
+#endif
+        }
+
+        Checkpoint(const Checkpoint&) = delete;
+        Checkpoint& operator=(const Checkpoint&) = delete;
+
+        // Journal for the job `key`, resumed when the stored search covers `start`, otherwise
+        // reset to start there. Released (and reusable) when the last reference is dropped.
+        std::shared_ptr<NonceJournal> journal(std::uint64_t key, std::uint64_t start, bool& resumed) {
+            std::lock_guard<std::mutex> lock(mutex);
+            Record* record = nullptr;
+            for (size_t i = 0; i < records && !record; ++i) {
+                if (table[i].magic == magic && table[i].key == key && !inUse[i]) {
+                    record = &table[i];
+                }
+            }
+            resumed = record && record->start <= start && start <= record->journal.cursor.load();
+            if (!resumed) {
+                record = record ? record : oldest();
+                record->magic = 0;
+                record->key = key;
+                record->start = start;
+                record->journal.cursor.store(start);
+                record->journal.nonce.store(0);
+                record->journal.zeros.store(-1);
+                for (auto& range : record->journal.ranges) {
+                    range.next.store(0);
+                    range.end.store(0);
+                }
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                record->magic = magic;
+            }
+            record->used = static_cast<std::uint64_t>(std::time(nullptr));
+            const size_t index = static_cast<size_t>(record - table);
+            inUse[index] = true;
+            return std::shared_ptr<NonceJournal>(&record->journal, [this, index](NonceJournal*) {
+                std::lock_guard<std::mutex> lock(mutex);
+                inUse[index] = false;
+            });
+        }
+
+        // Schedules write-back of the mapping without blocking.
+        void flush() {
+#if !defined(_WIN32)
+            msync(table, sizeof(Record) * records, MS_ASYNC);
+#endif
+        }
+
+    private:
+        static constexpr std::uint64_t magic = 0x4b414c45434b5031ULL;
+
+        struct Record {
+            std::uint64_t magic;
+            std::uint64_t key;
+            std::uint64_t start;
+            std::uint64_t used;
+            NonceJournal journal;
+        };
+
+        // Least recently used free record.
+        Record* oldest() {
+            Record* record = nullptr;
+            for (size_t i = 0; i < records; ++i) {
+                if (!inUse[i] && (!record || table[i].magic != magic || table[i].used < record->used)) {
+                    record = &table[i];
+                    if (table[i].magic != magic) {
+                        break;
+                    }
+                }
+            }
+            if (!record) {
+                throw std::runtime_error("Checkpoint file has no free record.");
+            }
+            return record;
+        }
+
+        int fd = -1;
+        Record* table = nullptr;
+        bool inUse[records] = {};
+        std::mutex mutex;
+        std::condition_variable stopped;
+        bool stopping = false;
+        std::thread flusher;
+};
+
+// FNV-1a, used to key checkpoint records.
+inline std::uint64_t fnv1a(const std::uint8_t* data, size_t size, std::uint64_t hash = 0xcbf29ce484222325ULL) {
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
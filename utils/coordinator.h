@@ -0,0 +1,323 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Fleet nonce coordinator (--coordinator). Hands out time-limited nonce-range leases per
+    (block, hash, miner) so that miners on several hosts never search the same nonces. The
+    unsearched part of a lease whose client disconnects, or that expires, is reclaimed and
+    leased again first; clients report their progress, which also renews the lease. Reported
+    solutions are verified here before they are announced to the other clients. Only the client
+    holding a lease can report its progress or release it; there is no authentication, so the
+    coordinator listens on loopback unless given a bind address.
+
+    Protocol (newline-delimited JSON, one object per line):
+      {"op":"lease","block":37,"hash":"<base64>","miner":"G...","difficulty":8,"nonce":0,"count":N}
+        -> {"event":"lease","id":"7","start":S,"count":C,"ttl":30}
+        -> {"event":"solved","block":37,"hash":"<hex>","nonce":N}  (already solved)
+      {"op":"progress","id":"7","searched":K}                        (no reply)
+      {"op":"done","id":"7","searched":K}                            (no reply)
+      {"event":"solution","id":"7","hash":"<hex>","nonce":N}       (no reply)
+    `searched` counts the nonces from the lease start that are all searched; the rest of a
+    released lease is leased again (all of it without `searched`). Clients holding a
+    lease of a search receive {"event":"solved",...} once it is solved. A failed request is
+    answered with {"event":"error","op":"done","id":"7","message":"..."}, naming its op (or
+    event) and lease id when they could be read.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "channel.h"
+#include "json.h"
+#include "mining.h"
+
+class NonceCoordinator {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Leases expire `leaseSeconds` after they are handed out; clients size them to finish well before.
+        NonceCoordinator(double leaseSeconds, std::uint64_t maxLease, bool verbose)
+            : ttl(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(leaseSeconds))),
+              leaseSeconds(leaseSeconds), maxLease(maxLease), verbose(verbose) {}
+
+        // Serves one client until it disconnects, then reclaims the leases it still holds.
+        void serve(std::shared_ptr<LineChannel> channel) {
+            std::string line;
+            while (channel->readLine(line)) {
+                if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                    continue;
+                }
+                std::map<std::string, std::string> fields;
+                try {
+                    if (!parseJsonObject(line, fields)) {
+                        throw std::invalid_argument("Malformed request.");
+                    }
+                    if (fields["op"] == "lease") {
+                        channel->writeLine(lease(fields, channel));
+                    } else if (fields["op"] == "progress") {
+                        progress(std::stoull(fields["id"]), std::stoull(fields["searched"]), channel);
+                    } else if (fields["op"] == "done") {
+                        complete(std::stoull(fields["id"]), fields.count("searched") ? std::stoull(fields["searched"]) : 0, channel);
+                    } else if (fields["event"] == "solution") {
+                        solution(std::stoull(fields["id"]), std::stoull(fields["nonce"]), channel.get());
+                    } else {
+                        throw std::invalid_argument("Unknown request.");
+                    }
+                } catch (const std::exception& e) {
+                    const std::string op = fields["op"].empty() ? fields["event"] : fields["op"];
+                    channel->writeLine("{\"event\":\"error\""
+                        + (op.empty() ? std::string() : ",\"op\":" + jsonQuote(op))
+                        + (fields["id"].empty() ? std::string() : ",\"id\":" + jsonQuote(fields["id"]))
+                        + ",\"message\":" + jsonQuote(e.what()) + "}");
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto it = leases.begin(); it != leases.end();) {
+                if (it->second.owner == channel) {
+                    reclaim(it->second);
+                    it = leases.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+    private:
+        struct Lease {
+            std::string key;
+            std::uint64_t start = 0;
+            std::uint64_t count = 0;
+            // Nonces from `start` reported searched (see progress()).
+            std::uint64_t searched = 0;
+            int difficulty = 0;
+            Clock::time_point expires;
+            // Expired leases are kept (reclaimed) so that a late solution can still be matched,
+            // until their search is solved or pruned.
+            bool active = true;
+            std::shared_ptr<LineChannel> owner;
+        };
+
+        struct Search {
+            std::uint32_t block = 0;
+            Keccak256Miner engine;
+            std::uint64_t cursor = 0;
+            // Ranges [begin, end) of released or expired leases, leased again before the cursor moves.
+            std::deque<std::pair<std::uint64_t, std::uint64_t>> reclaimed;
+            int zeros = -1;
+            std::uint64_t nonce = 0;
+            Digest digest{};
+        };
+
+        std::string solvedEvent(const Search& search) const {
+            return "{\"event\":\"solved\",\"block\":" + std::to_string(search.block) + ",\"hash\":\""
+                + toHex(std::vector<std::uint8_t>(search.digest.begin(), search.digest.end()))
+                + "\",\"nonce\":" + std::to_string(search.nonce) + "}";
+        }
+
+        // Moves the unsearched range of an active lease back to its search.
+        void reclaim(Lease& lease) {
+            auto it = searches.find(lease.key);
+            if (lease.active && lease.searched < lease.count && it != searches.end()) {
+                it->second.reclaimed.emplace_back(lease.start + lease.searched, lease.start + lease.count);
+            }
+            lease.active = false;
+        }
+
+        std::string lease(std::map<std::string, std::string>& fields, const std::shared_ptr<LineChannel>& owner) {
+            for (const char* key : {"block", "hash", "miner", "difficulty"}) {
+                if (!fields.count(key)) {
+                    throw std::invalid_argument(std::string("Missing field: ") + key + ".");
+                }
+            }
+            const std::uint32_t block = static_cast<std::uint32_t>(std::stoul(fields["block"]));
+            const int difficulty = std::stoi(fields["difficulty"]);
+            difficultyCheck(difficulty);
+            const std::uint64_t start = fields.count("nonce") ? std::stoull(fields["nonce"]) : 0;
+            const std::uint64_t wanted = fields.count("count") ? std::stoull(fields["count"]) : 0;
+            const std::uint64_t count = std::max<std::uint64_t>(1, std::min(wanted ? wanted : maxLease, maxLease));
+            const std::string key = fields["block"] + "/" + fields["hash"] + "/" + fields["miner"];
+
+            std::lock_guard<std::mutex> lock(mutex);
+            expire();
+            auto it = searches.find(key);
+            if (it == searches.end()) {
+                // The first client of a search sets its start nonce. Searches of older blocks are
+                // dropped once a newer block is leased.
+                size_t nonceOffset = 0;
+                const std::vector<std::uint8_t> data = prepare(block, start, fields["hash"], fields["miner"], nonceOffset);
+                prune(block);
+                it = searches.emplace(key, Search()).first;
+                it->second.block = block;
+                it->second.cursor = start;
+                it->second.engine.init(data.data(), data.size(), nonceOffset);
+            }
+            Search& search = it->second;
+            if (search.zeros >= difficulty) {
+                return solvedEvent(search);
+            }
+            Lease lease{key, search.cursor, count, 0, difficulty, Clock::now() + ttl, true, owner};
+            if (!search.reclaimed.empty()) {
+                auto& range = search.reclaimed.front();
+                lease.start = range.first;
+                lease.count = std::min(count, range.second - range.first);
+                range.first += lease.count;
+                if (range.first >= range.second) {
+                    search.reclaimed.pop_front();
+                }
+            } else {
+                lease.count = std::min(count, UINT64_MAX - search.cursor);
+                if (lease.count == 0) {
+                    throw std::runtime_error("Nonce range exhausted.");
+                }
+                search.cursor += lease.count;
+            }
+            const std::uint64_t id = nextId++;
+            leases.emplace(id, lease);
+            if (verbose) {
+                std::cerr << "[Coordinator] Lease " << id << ": block " << block << " nonces " << lease.start
+                          << "+" << lease.count << std::endl;
+            }
+            return "{\"event\":\"lease\",\"id\":\"" + std::to_string(id) + "\",\"start\":" + std::to_string(lease.start)
+                + ",\"count\":" + std::to_string(lease.count) + ",\"ttl\":" + std::to_string(leaseSeconds) + "}";
+        }
+
+        // Lease `id` held by `owner` (other clients' lease ids are unknown to it).
+        Lease& owned(std::uint64_t id, const std::shared_ptr<LineChannel>& owner) {
+            auto it = leases.find(id);
+            if (it == leases.end() || it->second.owner != owner) {
+                throw std::invalid_argument("Unknown lease.");
+            }
+            return it->second;
+        }
+
+        // Records that the first `searched` nonces of an active lease are searched and renews it.
+        void progress(std::uint64_t id, std::uint64_t searched, const std::shared_ptr<LineChannel>& owner) {
+            std::lock_guard<std::mutex> lock(mutex);
+            Lease& lease = owned(id, owner);
+            if (!lease.active) {
+                throw std::invalid_argument("Unknown lease.");
+            }
+            lease.searched = std::max(lease.searched, std::min(searched, lease.count));
+            lease.expires = Clock::now() + ttl;
+        }
+
+        // Releases a lease, reclaiming the nonces after its `searched` prefix as on a disconnect.
+        void complete(std::uint64_t id, std::uint64_t searched, const std::shared_ptr<LineChannel>& owner) {
+            std::lock_guard<std::mutex> lock(mutex);
+            Lease& lease = owned(id, owner);
+            lease.searched = std::max(lease.searched, std::min(searched, lease.count));
+            reclaim(lease);
+            leases.erase(id);
+        }
+
+        // Verifies a reported nonce against its lease's search and announces it to the other
+        // clients with leases it satisfies. Reclaimed leases it satisfies are dropped.
+        void solution(std::uint64_t id, std::uint64_t nonce, const LineChannel* reporter) {
+            std::vector<std::shared_ptr<LineChannel>> notify;
+            std::string event;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto lease = leases.find(id);
+                if (lease == leases.end()) {
+                    throw std::invalid_argument("Unknown lease.");
+                }
+                auto it = searches.find(lease->second.key);
+                if (it == searches.end()) {
+                    return;
+                }
+                Search& search = it->second;
+                Digest digest;
+                search.engine.digest(nonce, digest.data());
+                const int zeros = zeroNibbles(digest.data());
+                if (zeros < lease->second.difficulty) {
+                    throw std::invalid_argument("Invalid solution.");
+                }
+                if (zeros <= search.zeros) {
+                    return;
+                }
+                search.zeros = zeros;
+                search.nonce = nonce;
+                search.digest = digest;
+                event = solvedEvent(search);
+                if (verbose) {
+                    std::cerr << "[Coordinator] Solved block " << search.block << " (" << zeros << " zeros) by lease " << id << std::endl;
+                }
+                const std::string key = lease->second.key;
+                for (auto held = leases.begin(); held != leases.end();) {
+                    if (held->second.key != key || held->second.difficulty > zeros) {
+                        ++held;
+                    } else if (!held->second.active) {
+                        held = leases.erase(held);
+                    } else {
+                        if (held->second.owner.get() != reporter) {
+                            notify.push_back(held->second.owner);
+                        }
+                        ++held;
+                    }
+                }
+            }
+            std::sort(notify.begin(), notify.end());
+            notify.erase(std::unique(notify.begin(), notify.end()), notify.end());
+            for (auto& channel : notify) {
+                channel->writeLine(event);
+            }
+        }
+
+        // Reclaims the leases that were neither renewed nor completed in time, and drops the
+        // reclaimed leases whose search is solved for them.
+        void expire() {
+            const auto now = Clock::now();
+            for (auto it = leases.begin(); it != leases.end();) {
+                Lease& lease = it->second;
+                if (lease.active && lease.expires <= now) {
+                    if (verbose) {
+                        std::cerr << "[Coordinator] Lease " << it->first << " expired" << std::endl;
+                    }
+                    reclaim(lease);
+                }
+                auto search = searches.find(lease.key);
+                if (!lease.active && (search == searches.end() || search->second.zeros >= lease.difficulty)) {
+                    it = leases.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        void prune(std::uint32_t block) {
+            for (auto it = searches.begin(); it != searches.end();) {
+                if (it->second.block < block) {
+                    const std::string key = it->first;
+                    for (auto lease = leases.begin(); lease != leases.end();) {
+                        lease = lease->second.key == key ? leases.erase(lease) : std::next(lease);
+                    }
+                    it = searches.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        const Clock::duration ttl;
+        const double leaseSeconds;
+        const std::uint64_t maxLease;
+        const bool verbose;
+        std::mutex mutex;
+        std::map<std::string, Search> searches;
+        std::map<std::uint64_t, Lease> leases;
+        std::uint64_t nextId = 1;
+};
@@ -0,0 +1,148 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Resident CPU mining engine: a pinned worker pool mining one published job at a time. Used
+    by the daemon (--daemon), the fleet client (--join) and the embeddable library (kaleminer.h).
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mining.h"
+#include "topology.h"
+#include "trace.h"
+
+// Starts the worker pool, pinning each worker first when a placement is given.
+inline std::vector<std::thread> startWorkers(size_t workers, const std::vector<CpuInfo>& placement,
+    const std::function<void(size_t)>& work) {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back([&placement, work, i]() {
+            TRACE_THREAD("worker " + std::to_string(i));
+            {
+                TRACE_SPAN("worker start");
+                if (!placement.empty() && !pinThread(placement[i % placement.size()].cpu)) {
+                    std::cerr << "[CPU] Failed to pin worker " << i << "\n";
+                }
+            }
+            work(i);
+        });
+    }
+    return threads;
+}
+
+// Current job of the engine. Writers swap the pointer atomically and bump `epoch`; workers only
+// take the mutex to sleep while there is nothing new to mine.
+struct JobBoard {
+    std::shared_ptr<MiningJob> current;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::uint64_t epoch = 0;
+    bool running = true;
+
+    void publish(std::shared_ptr<MiningJob> job) {
+        auto previous = std::atomic_exchange(&current, job);
+        if (previous) {
+            previous->replaced.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+            previous->stop.store(true, std::memory_order_relaxed);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        epoch++;
+        changed.notify_all();
+    }
+
+    void shutdown() {
+        publish(nullptr);
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        changed.notify_all();
+    }
+};
+
+class MiningEngine {
+    public:
+        // Called on the worker that published a job's solution.
+        using Solved = std::function<void(MiningJob& job)>;
+
+        MiningEngine(size_t workers, std::vector<CpuInfo> placement, const KeccakBackend& keccak, Solved solved)
+            : placement(std::move(placement)), keccak(keccak), solved(std::move(solved)) {
+            threads = startWorkers(workers, this->placement, [this](size_t i) { work(i); });
+        }
+
+        ~MiningEngine() {
+            board.shutdown();
+            for (auto& t : threads) {
+                t.join();
+            }
+        }
+
+        MiningEngine(const MiningEngine&) = delete;
+        MiningEngine& operator=(const MiningEngine&) = delete;
+
+        // Preempts the current job within one chunk; nullptr idles the workers.
+        void publish(std::shared_ptr<MiningJob> job) {
+            board.publish(std::move(job));
+        }
+
+        std::shared_ptr<MiningJob> current() {
+            return std::atomic_load(&board.current);
+        }
+
+        size_t workers() const {
+            return threads.size();
+        }
+
+    private:
+        void work(size_t worker) {
+            std::uint64_t seen = 0;
+            while (true) {
+                {
+                    TRACE_SPAN("idle");
+                    std::unique_lock<std::mutex> lock(board.mutex);
+                    board.changed.wait(lock, [&]() { return !board.running || board.epoch != seen; });
+                    if (!board.running) {
+                        return;
+                    }
+                    seen = board.epoch;
+                }
+                std::shared_ptr<MiningJob> job = std::atomic_load(&board.current);
+                if (!job) {
+                    continue;
+                }
+                bool found = false;
+                {
+                    TRACE_SPAN("job", job->block);
+                    found = find(worker, *job, keccak, false, []() { return false; });
+                }
+                if (found) {
+                    TRACE_SPAN("publish", job->nonce);
+                    if (solved) {
+                        solved(*job);
+                    }
+                } else if (const std::int64_t replaced = job->replaced.load(std::memory_order_relaxed)) {
+                    const std::chrono::steady_clock::duration since(replaced);
+                    metrics.observeJobSwitch(secondsSince(std::chrono::steady_clock::time_point(since)));
+                }
+            }
+        }
+
+        const std::vector<CpuInfo> placement;
+        const KeccakBackend& keccak;
+        const Solved solved;
+        JobBoard board;
+        std::vector<std::thread> threads;
+};
@@ -0,0 +1,150 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Minimal JSON helpers for the newline-delimited control protocol. Objects are read one level
+    deep: strings are unescaped, other values (numbers, booleans, nested objects and arrays)
+    are returned as raw text.
+*/
+
+#pragma once
+
+#include <cctype>
+#include <cstdio>
+#include <map>
+#include <string>
+
+inline void skipJsonSpace(const std::string& text, size_t& pos) {
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+        pos++;
+    }
+}
+
+inline bool readJsonString(const std::string& text, size_t& pos, std::string& value) {
+    if (pos >= text.size() || text[pos] != '"') {
+        return false;
+    }
+    value.clear();
+    for (++pos; pos < text.size(); ++pos) {
+        char c = text[pos];
+        if (c == '"') {
+            pos++;
+            return true;
+        }
+        if (c == '\\' && ++pos < text.size()) {
+            switch (text[pos]) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'u': {
+                    if (pos + 4 >= text.size()) {
+                        return false;
+                    }
+                    unsigned code = std::stoul(text.substr(pos + 1, 4), nullptr, 16);
+                    pos += 4;
+                    c = code < 0x80 ? static_cast<char>(code) : '?';
+                    break;
+                }
+                default: c = text[pos]; break;
+            }
+        }
+        value += c;
+    }
+    return false;
+}
+
+// Raw text of a non-string value, balancing brackets for nested objects and arrays.
+inline bool readJsonRaw(const std::string& text, size_t& pos, std::string& value) {
+    const size_t start = pos;
+    int depth = 0;
+    std::string ignored;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (c == '"') {
+            if (!readJsonString(text, pos, ignored)) {
+                return false;
+            }
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) {
+                break;
+            }
+            depth--;
+        } else if (c == ',' && depth == 0) {
+            break;
+        }
+        pos++;
+    }
+    value = text.substr(start, pos - start);
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back()))) {
+        value.pop_back();
+    }
+    return depth == 0 && !value.empty();
+}
+
+inline bool parseJsonObject(const std::string& text, std::map<std::string, std::string>& fields) {
+    size_t pos = 0;
+    skipJsonSpace(text, pos);
+    if (pos >= text.size() || text[pos++] != '{') {
+        return false;
+    }
+    fields.clear();
+    skipJsonSpace(text, pos);
+    if (pos < text.size() && text[pos] == '}') {
+        return true;
+    }
+    while (pos < text.size()) {
+        std::string key, value;
+        skipJsonSpace(text, pos);
+        if (!readJsonString(text, pos, key)) {
+            return false;
+        }
+        skipJsonSpace(text, pos);
+        if (pos >= text.size() || text[pos++] != ':') {
+            return false;
+        }
+        skipJsonSpace(text, pos);
+        bool ok = pos < text.size() && (text[pos] == '"' ? readJsonString(text, pos, value) : readJsonRaw(text, pos, value));
+        if (!ok) {
+            return false;
+        }
+        fields[key] = value;
+        skipJsonSpace(text, pos);
+        if (pos < text.size() && text[pos] == ',') {
+            pos++;
+        } else {
+            return pos < text.size() && text[pos] == '}';
+        }
+    }
+    return false;
+}
+
+inline std::string jsonQuote(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
@@ -13,12 +13,15 @@
 
 #include <cstdint>
 #include <cstring>
+#include <stdexcept>
+#include <vector>
 
 #ifndef KECCAK
 #define KECCAK 0
 #endif
 #define KECCAK_REF 1
 #define KECCAK_OPT 2
+#define KECCAK_LC 3
 
 #if defined(_MSC_VER)
 #define RESTRICT __restrict
@@ -29,16 +32,24 @@ INLINE void* assume_aligned(void* p, size_t align) {
 }
 #define ASSUME_ALIGNED(p, a) assume_aligned((p), (a))
 #define PREFETCH_READ(p)
+#define BSWAP64(x) _byteswap_uint64(x)
 #elif defined(__GNUC__) || defined(__clang__)
 #define RESTRICT __restrict__
 #define INLINE inline __attribute__((always_inline))
 #define ASSUME_ALIGNED(p, a) __builtin_assume_aligned((p), (a))
 #define PREFETCH_READ(p) __builtin_prefetch((p), 0, 3)
+#define BSWAP64(x) __builtin_bswap64(x)
 #else
 #define RESTRICT
 #define INLINE inline
 #define ASSUME_ALIGNED(p, a) (p)
 #define PREFETCH_READ(p)
+#define BSWAP64(x) bswap64(x)
+static inline uint64_t bswap64(uint64_t x) {
+    x = ((x & 0x00ff00ff00ff00ffULL) << 8) | ((x >> 8) & 0x00ff00ff00ff00ffULL);
+    x = ((x & 0x0000ffff0000ffffULL) << 16) | ((x >> 16) & 0x0000ffff0000ffffULL);
+    return (x << 32) | (x >> 32);
+}
 #endif
 
 #if defined(_MSC_VER)
@@ -56,12 +67,84 @@ INLINE void* assume_aligned(void* p, size_t align) {
 #define PRAGMA_UNROLL(x)
 #endif
 
-#if KECCAK == KECCAK_OPT
 #include "keccak_opt.h"
-#endif
+#include "keccak_lc.h"
+#include "keccak_ref.h"
+
+static INLINE uint64_t rotl64(uint64_t x, uint64_t n) {
+    return (x << n) | (x >> (64 - n));
+}
+
+static INLINE void portable_keccakF1600(uint8_t* RESTRICT state) {
+    static constexpr uint64_t roundConstants[24] = {
+        0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+        0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+        0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+        0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+        0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+        0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+    };
+    static constexpr size_t rhoOffsets[24] = {
+        1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14,
+        27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44
+    };
+    static constexpr size_t piIndexes[24] = {
+        10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4,
+        15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1
+    };
+
+    uint64_t* RESTRICT state64 = reinterpret_cast<uint64_t*>(ASSUME_ALIGNED(state, 64));
+    for (uint64_t roundConstant : roundConstants) {
+        PREFETCH_READ(state64);
+        const uint64_t c0 = state64[0] ^ state64[5] ^ state64[10] ^ state64[15] ^ state64[20];
+        const uint64_t c1 = state64[1] ^ state64[6] ^ state64[11] ^ state64[16] ^ state64[21];
+        const uint64_t c2 = state64[2] ^ state64[7] ^ state64[12] ^ state64[17] ^ state64[22];
+        const uint64_t c3 = state64[3] ^ state64[8] ^ state64[13] ^ state64[18] ^ state64[23];
+        const uint64_t c4 = state64[4] ^ state64[9] ^ state64[14] ^ state64[19] ^ state64[24];
+
+        const uint64_t d0 = c4 ^ rotl64(c1, 1);
+        const uint64_t d1 = c0 ^ rotl64(c2, 1);
+        const uint64_t d2 = c1 ^ rotl64(c3, 1);
+        const uint64_t d3 = c2 ^ rotl64(c4, 1);
+        const uint64_t d4 = c3 ^ rotl64(c0, 1);
+
+        state64[0] ^= d0;  state64[5] ^= d0;  state64[10] ^= d0; state64[15] ^= d0; state64[20] ^= d0;
+        state64[1] ^= d1;  state64[6] ^= d1;  state64[11] ^= d1; state64[16] ^= d1; state64[21] ^= d1;
+        state64[2] ^= d2;  state64[7] ^= d2;  state64[12] ^= d2; state64[17] ^= d2; state64[22] ^= d2;
+        state64[3] ^= d3;  state64[8] ^= d3;  state64[13] ^= d3; state64[18] ^= d3; state64[23] ^= d3;
+        state64[4] ^= d4;  state64[9] ^= d4;  state64[14] ^= d4; state64[19] ^= d4; state64[24] ^= d4;
+
+        uint64_t temp = state64[1];
+        PRAGMA_IVDEP
+        PRAGMA_UNROLL(24)
+        for (size_t i = 0; i < 24; ++i) {
+            const size_t pi = piIndexes[i];
+            const size_t ro = rhoOffsets[i];
+            const uint64_t t = state64[pi];
+            state64[pi] = rotl64(temp, ro);
+            temp = t;
+        }
+
+        PRAGMA_IVDEP
+        PRAGMA_UNROLL(5)
+        for (size_t y = 0; y < 25; y += 5) {
+            const uint64_t x0 = state64[y];
+            const uint64_t x1 = state64[y + 1];
+            const uint64_t x2 = state64[y + 2];
+            const uint64_t x3 = state64[y + 3];
+            const uint64_t x4 = state64[y + 4];
+            state64[y] = x0 ^ ((~x1) & x2);
+            state64[y + 1] = x1 ^ ((~x2) & x3);
+            state64[y + 2] = x2 ^ ((~x3) & x4);
+            state64[y + 3] = x3 ^ ((~x4) & x0);
+            state64[y + 4] = x4 ^ ((~x0) & x1);
+        }
+
+        state64[0] ^= roundConstant;
+    }
+}
 
 #if KECCAK == KECCAK_REF
-#include "keccak_ref.h"
 class Keccak256 {
     public:
         Keccak256() { reset(); }
@@ -122,80 +205,13 @@ class Keccak256 {
         static void keccakF1600(uint8_t* RESTRICT state) {
             #if KECCAK == KECCAK_OPT
             fast_keccakF1600(state);
+            #elif KECCAK == KECCAK_LC
+            lc_keccakF1600(state);
             #else
-            static constexpr uint64_t roundConstants[24] = {
-                0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
-                0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
-                0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
-                0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
-                0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
-                0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
-            };
-            static constexpr size_t rhoOffsets[24] = {
-                1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14,
-                27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44
-            };
-            static constexpr size_t piIndexes[24] = {
-                10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4,
-                15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1
-            };
-
-            uint64_t* RESTRICT state64 = reinterpret_cast<uint64_t*>(ASSUME_ALIGNED(state, 64));
-            for (uint64_t roundConstant : roundConstants) {
-                PREFETCH_READ(state64);
-                const uint64_t c0 = state64[0] ^ state64[5] ^ state64[10] ^ state64[15] ^ state64[20];
-                const uint64_t c1 = state64[1] ^ state64[6] ^ state64[11] ^ state64[16] ^ state64[21];
-                const uint64_t c2 = state64[2] ^ state64[7] ^ state64[12] ^ state64[17] ^ state64[22];
-                const uint64_t c3 = state64[3] ^ state64[8] ^ state64[13] ^ state64[18] ^ state64[23];
-                const uint64_t c4 = state64[4] ^ state64[9] ^ state64[14] ^ state64[19] ^ state64[24];
-
-                const uint64_t d0 = c4 ^ rotl64(c1, 1);
-                const uint64_t d1 = c0 ^ rotl64(c2, 1);
-                const uint64_t d2 = c1 ^ rotl64(c3, 1);
-                const uint64_t d3 = c2 ^ rotl64(c4, 1);
-                const uint64_t d4 = c3 ^ rotl64(c0, 1);
-
-                state64[0] ^= d0;  state64[5] ^= d0;  state64[10] ^= d0; state64[15] ^= d0; state64[20] ^= d0;
-                state64[1] ^= d1;  state64[6] ^= d1;  state64[11] ^= d1; state64[16] ^= d1; state64[21] ^= d1;
-                state64[2] ^= d2;  state64[7] ^= d2;  state64[12] ^= d2; state64[17] ^= d2; state64[22] ^= d2;
-                state64[3] ^= d3;  state64[8] ^= d3;  state64[13] ^= d3; state64[18] ^= d3; state64[23] ^= d3;
-                state64[4] ^= d4;  state64[9] ^= d4;  state64[14] ^= d4; state64[19] ^= d4; state64[24] ^= d4;
-
-                uint64_t temp = state64[1];
-                PRAGMA_IVDEP
-                PRAGMA_UNROLL(24)
-                for (size_t i = 0; i < 24; ++i) {
-                    const size_t pi = piIndexes[i];
-                    const size_t ro = rhoOffsets[i];
-                    const uint64_t t = state64[pi];
-                    state64[pi] = rotl64(temp, ro);
-                    temp = t;
-                }
-
-                PRAGMA_IVDEP
-                PRAGMA_UNROLL(5)
-                for (size_t y = 0; y < 25; y += 5) {
-                    const uint64_t x0 = state64[y];
-                    const uint64_t x1 = state64[y + 1];
-                    const uint64_t x2 = state64[y + 2];
-                    const uint64_t x3 = state64[y + 3];
-                    const uint64_t x4 = state64[y + 4];
-                    state64[y] = x0 ^ ((~x1) & x2);
-                    state64[y + 1] = x1 ^ ((~x2) & x3);
-                    state64[y + 2] = x2 ^ ((~x3) & x4);
-                    state64[y + 3] = x3 ^ ((~x4) & x0);
-                    state64[y + 4] = x4 ^ ((~x0) & x1);
-                }
-
-                state64[0] ^= roundConstant;
-            }
+            portable_keccakF1600(state);
             #endif
         }
 
-        static INLINE uint64_t rotl64(uint64_t x, uint64_t n) {
-            return (x << n) | (x >> (64 - n));
-        }
-
         #if defined(TESTS)
         int runTests() {
             std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> testCases = {
@@ -241,4 +257,185 @@ class Keccak256 {
         }
         #endif
     };
-#endif
\ No newline at end of file
+#endif
+
+/*
+    Mining engine specialized for the single-block KALE message (block, nonce, entropy, miner).
+
+    Only the nonce lanes change between attempts, so the padded message is kept as a per-job
+    template and the constant part of the first-round theta is precomputed. The final round only
+    computes the first output lane, which is all the difficulty check needs; the full digest is
+    only recomputed for candidate nonces.
+
+    Lane operations are templates so wider lane types (SIMD, multi-buffer) can reuse the rounds.
+*/
+
+template <int N>
+static INLINE uint64_t laneRotl(uint64_t x) {
+    return (x << N) | (x >> (64 - N));
+}
+
+static INLINE uint64_t laneChi(uint64_t a, uint64_t b, uint64_t c) {
+    return a ^ ((~b) & c);
+}
+
+// Fused theta-rho-pi-chi-iota with the theta effect d0..d4 supplied: reads the state from a, writes it to e.
+template <typename T>
+static INLINE void keccakRound(const T* RESTRICT a, T* RESTRICT e, const T& d0, const T& d1, const T& d2,
+    const T& d3, const T& d4, const T& roundConstant) {
+    #define CHI_ROW(y, i0, d0_, r0, i1, d1_, r1, i2, d2_, r2, i3, d3_, r3, i4, d4_, r4) do { \
+        const T b0 = laneRotl<r0>(a[i0] ^ d0_); \
+        const T b1 = laneRotl<r1>(a[i1] ^ d1_); \
+        const T b2 = laneRotl<r2>(a[i2] ^ d2_); \
+        const T b3 = laneRotl<r3>(a[i3] ^ d3_); \
+        const T b4 = laneRotl<r4>(a[i4] ^ d4_); \
+        e[y] = laneChi(b0, b1, b2); \
+        e[y + 1] = laneChi(b1, b2, b3); \
+        e[y + 2] = laneChi(b2, b3, b4); \
+        e[y + 3] = laneChi(b3, b4, b0); \
+        e[y + 4] = laneChi(b4, b0, b1); \
+    } while(0)
+    {
+        const T b0 = a[0] ^ d0;
+        const T b1 = laneRotl<44>(a[6] ^ d1);
+        const T b2 = laneRotl<43>(a[12] ^ d2);
+        const T b3 = laneRotl<21>(a[18] ^ d3);
+        const T b4 = laneRotl<14>(a[24] ^ d4);
+        e[0] = laneChi(b0, b1, b2) ^ roundConstant;
+        e[1] = laneChi(b1, b2, b3);
+        e[2] = laneChi(b2, b3, b4);
+        e[3] = laneChi(b3, b4, b0);
+        e[4] = laneChi(b4, b0, b1);
+    }
+    CHI_ROW(5, 3, d3, 28, 9, d4, 20, 10, d0, 3, 16, d1, 45, 22, d2, 61);
+    CHI_ROW(10, 1, d1, 1, 7, d2, 6, 13, d3, 25, 19, d4, 8, 20, d0, 18);
+    CHI_ROW(15, 4, d4, 27, 5, d0, 36, 11, d1, 10, 17, d2, 15, 23, d3, 56);
+    CHI_ROW(20, 2, d2, 62, 8, d3, 55, 14, d4, 39, 15, d0, 41, 21, d1, 2);
+    #undef CHI_ROW
+}
+
+template <typename T>
+static INLINE void keccakRound(const T* RESTRICT a, T* RESTRICT e, const T& roundConstant) {
+    const T c0 = a[0] ^ a[5] ^ a[10] ^ a[15] ^ a[20];
+    const T c1 = a[1] ^ a[6] ^ a[11] ^ a[16] ^ a[21];
+    const T c2 = a[2] ^ a[7] ^ a[12] ^ a[17] ^ a[22];
+    const T c3 = a[3] ^ a[8] ^ a[13] ^ a[18] ^ a[23];
+    const T c4 = a[4] ^ a[9] ^ a[14] ^ a[19] ^ a[24];
+    keccakRound(a, e, c4 ^ laneRotl<1>(c1), c0 ^ laneRotl<1>(c2), c1 ^ laneRotl<1>(c3),
+        c2 ^ laneRotl<1>(c4), c3 ^ laneRotl<1>(c0), roundConstant);
+}
+
+// First digest lane (bytes 0-7, little-endian) for the nonce lanes n0/n1.
+// theta holds the nonce-free parities {c0, c1, c3, c4, rotl(c2, 1), rotl(c3, 1), d3}.
+template <typename T>
+static INLINE T keccakHead(const T* lanes, const T* theta, const T* roundConstants, const T& n0, const T& n1) {
+    T a[25], e[25];
+    PRAGMA_UNROLL(25)
+    for (int i = 0; i < 25; ++i)
+        a[i] = lanes[i];
+    a[0] = a[0] ^ n0;
+    a[1] = a[1] ^ n1;
+
+    // Round 0: only the columns holding the nonce lanes change their parity.
+    const T c0 = theta[0] ^ n0;
+    const T c1 = theta[1] ^ n1;
+    keccakRound(a, e, theta[3] ^ laneRotl<1>(c1), c0 ^ theta[4], c1 ^ theta[5],
+        theta[6], theta[2] ^ laneRotl<1>(c0), roundConstants[0]);
+
+    PRAGMA_UNROLL(11)
+    for (int round = 1; round < 23; round += 2) {
+        keccakRound(e, a, roundConstants[round]);
+        keccakRound(a, e, roundConstants[round + 1]);
+    }
+
+    // Round 23: only lane 0 of the output is needed (row 0 chi on lanes 0, 6 and 12).
+    const T c0e = e[0] ^ e[5] ^ e[10] ^ e[15] ^ e[20];
+    const T c1e = e[1] ^ e[6] ^ e[11] ^ e[16] ^ e[21];
+    const T c2e = e[2] ^ e[7] ^ e[12] ^ e[17] ^ e[22];
+    const T c3e = e[3] ^ e[8] ^ e[13] ^ e[18] ^ e[23];
+    const T c4e = e[4] ^ e[9] ^ e[14] ^ e[19] ^ e[24];
+    const T b0 = e[0] ^ c4e ^ laneRotl<1>(c1e);
+    const T b1 = laneRotl<44>(e[6] ^ c0e ^ laneRotl<1>(c2e));
+    const T b2 = laneRotl<43>(e[12] ^ c1e ^ laneRotl<1>(c3e));
+    return laneChi(b0, b1, b2) ^ roundConstants[23];
+}
+
+class Keccak256Miner {
+    public:
+        static constexpr size_t rate = 136;
+        static constexpr uint64_t roundConstants[24] = {
+            0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+            0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+            0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+            0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+            0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+            0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+        };
+
+        // The message must fit a single block and the 8 big-endian nonce bytes must straddle lanes 0 and 1.
+        void init(const uint8_t* data, size_t size, size_t nonceOffset) {
+            if (size >= rate || nonceOffset == 0 || nonceOffset >= 8) {
+                throw std::invalid_argument("Unsupported message layout.");
+            }
+            alignas(8) uint8_t padded[200] = {};
+            std::memcpy(padded, data, size);
+            std::memset(padded + nonceOffset, 0, 8);
+            padded[size] ^= 0x01;
+            padded[rate - 1] ^= 0x80;
+            std::memcpy(lanes, padded, sizeof(lanes));
+            shift = static_cast<unsigned>(nonceOffset * 8);
+            precompute();
+        }
+
+        // Replaces `size` message bytes at `offset` (clear of the nonce and the padding), so jobs
+        // that differ only there share the rest of the template.
+        void patch(size_t offset, const uint8_t* bytes, size_t size) {
+            std::memcpy(reinterpret_cast<uint8_t*>(lanes) + offset, bytes, size);
+            precompute();
+        }
+
+        INLINE void nonceLanes(uint64_t nonce, uint64_t& n0, uint64_t& n1) const {
+            const uint64_t bytes = BSWAP64(nonce);
+            n0 = bytes << shift;
+            n1 = bytes >> (64 - shift);
+        }
+
+        INLINE uint64_t head(uint64_t nonce) const {
+            uint64_t n0, n1;
+            nonceLanes(nonce, n0, n1);
+            return keccakHead<uint64_t>(lanes, theta, roundConstants, n0, n1);
+        }
+
+        void digest(uint64_t nonce, uint8_t* hash) const {
+            uint64_t n0, n1;
+            nonceLanes(nonce, n0, n1);
+            uint64_t a[25], e[25];
+            std::memcpy(a, lanes, sizeof(a));
+            a[0] ^= n0;
+            a[1] ^= n1;
+            for (int round = 0; round < 24; round += 2) {
+                keccakRound(a, e, roundConstants[round]);
+                keccakRound(e, a, roundConstants[round + 1]);
+            }
+            std::memcpy(hash, a, 32);
+        }
+
+        uint64_t lanes[25];   // Padded message with the nonce bytes cleared.
+        uint64_t theta[7];    // See keccakHead().
+        unsigned shift = 0;
+
+    private:
+        // Theta terms of the nonce-free lanes, see keccakHead().
+        void precompute() {
+            uint64_t c[5];
+            for (int x = 0; x < 5; ++x)
+                c[x] = lanes[x] ^ lanes[x + 5] ^ lanes[x + 10] ^ lanes[x + 15] ^ lanes[x + 20];
+            theta[0] = c[0];
+            theta[1] = c[1];
+            theta[2] = c[3];
+            theta[3] = c[4];
+            theta[4] = laneRotl<1>(c[2]);
+            theta[5] = laneRotl<1>(c[3]);
+            theta[6] = c[2] ^ laneRotl<1>(c[4]);
+        }
+};
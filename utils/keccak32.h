@@ -0,0 +1,65 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Bit-interleaved Keccak lanes for 32-bit hosts (ARMv7, x86 -m32). Each 64-bit lane is held as
+    two 32-bit words, the even bits and the odd bits, so a 64-bit rotation is a pair of 32-bit
+    rotations instead of the shift/or sequences a 32-bit compiler emits for uint64_t. Plugs into
+    keccakSearch() as a one-nonce lane type, see keccak_simd.h.
+*/
+
+#pragma once
+
+#include "keccak_simd.h"
+
+template <int N>
+static INLINE uint32_t rotl32(uint32_t x) {
+    return N % 32 == 0 ? x : (x << (N % 32)) | (x >> ((32 - N % 32) % 32));
+}
+
+// Gathers the even bits of x into the low 32 bits.
+static INLINE uint32_t evenBits(uint64_t x) {
+    x &= 0x5555555555555555ULL;
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x >> 4)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x >> 8)) & 0x0000ffff0000ffffULL;
+    x = (x | (x >> 16)) & 0x00000000ffffffffULL;
+    return static_cast<uint32_t>(x);
+}
+
+struct Lane32 {
+    static constexpr int width = 1;
+    uint32_t even;
+    uint32_t odd;
+    Lane32() = default;
+    Lane32(uint32_t even, uint32_t odd) : even(even), odd(odd) {}
+    explicit Lane32(uint64_t x) : even(evenBits(x)), odd(evenBits(x >> 1)) {}
+    static INLINE Lane32 load(const uint64_t* p) { return Lane32(*p); }
+};
+
+static INLINE Lane32 operator^(const Lane32& a, const Lane32& b) { return Lane32(a.even ^ b.even, a.odd ^ b.odd); }
+
+// Odd rotations swap the halves: bit 2i moves to 2i + N, an odd position.
+template <int N>
+static INLINE Lane32 laneRotl(const Lane32& x) {
+    if (N % 2 == 0) {
+        return Lane32(rotl32<N / 2>(x.even), rotl32<N / 2>(x.odd));
+    }
+    return Lane32(rotl32<(N + 1) / 2>(x.odd), rotl32<N / 2>(x.even));
+}
+
+static INLINE Lane32 laneChi(const Lane32& a, const Lane32& b, const Lane32& c) {
+    return Lane32(a.even ^ (~b.even & c.even), a.odd ^ (~b.odd & c.odd));
+}
+
+static INLINE unsigned laneZeros(const Lane32& x, const Lane32& mask) {
+    return ((x.even & mask.even) | (x.odd & mask.odd)) == 0;
+}
+
+static bool keccakSearchInterleaved(const Keccak256Miner& job, uint64_t mask, uint64_t start, uint64_t count, uint64_t& nonce) {
+    return keccakSearch<Lane32>(job, mask, start, count, nonce);
+}
@@ -0,0 +1,246 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Runtime selection of the Keccak mining backend. Every backend is compiled into the binary;
+    SIMD ones are gated by CPUID (x86) or HWCAP (aarch64), and "auto" picks the fastest
+    supported backend with a short benchmark on the host. The bit-interleaved 32-bit backend
+    only enters that benchmark on 32-bit targets.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "keccak32.h"
+#include "keccak_simd.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KECCAK_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#if UINTPTR_MAX == 0xffffffffu
+#define KECCAK_32BIT 1
+#else
+#define KECCAK_32BIT 0
+#endif
+
+// Build-time KECCAK choice only sets the default backend; --keccak overrides it.
+#if KECCAK == KECCAK_REF
+#define KECCAK_DEFAULT "ref"
+#elif KECCAK == KECCAK_OPT
+#define KECCAK_DEFAULT "opt"
+#elif KECCAK == KECCAK_LC
+#define KECCAK_DEFAULT "lc"
+#else
+#define KECCAK_DEFAULT "auto"
+#endif
+
+// Scans [start, start + count) and returns true with the first nonce whose first digest lane
+// has all `mask` bits clear.
+typedef bool (*KeccakSearchFn)(const Keccak256Miner& job, uint64_t mask, uint64_t start, uint64_t count, uint64_t& nonce);
+
+struct KeccakBackend {
+    const char* name;
+    KeccakSearchFn search;
+    bool (*supported)();
+    bool autotune;
+};
+
+#if defined(KECCAK_X86)
+bool keccakSearchAvx2(const Keccak256Miner& job, uint64_t mask, uint64_t start, uint64_t count, uint64_t& nonce);
+bool keccakSearchAvx512(const Keccak256Miner& job, uint64_t mask, uint64_t start, uint64_t count, uint64_t& nonce);
+
+static inline void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+    #if defined(_MSC_VER)
+    __cpuidex(reinterpret_cast<int*>(regs), static_cast<int>(leaf), static_cast<int>(subleaf));
+    #else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+}
+
+// OS-enabled register state (XCR0).
+static inline uint64_t xcr0() {
+    #if defined(_MSC_VER)
+    return _xgetbv(0);
+    #else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+    #endif
+}
+
+static inline bool cpuHasXsaveState(uint64_t mask) {
+    unsigned regs[4];
+    cpuid(0, 0, regs);
+    if (regs[0] < 7) {
+        return false;
+    }
+    cpuid(1, 0, regs);
+    const bool osxsave = regs[2] & (1u << 27);
+    return osxsave && (xcr0() & mask) == mask;
+}
+
+static inline bool cpuHasAvx2() {
+    unsigned regs[4];
+    if (!cpuHasXsaveState(0x6)) {
+        return false;
+    }
+    cpuid(7, 0, regs);
+    return regs[1] & (1u << 5);
+}
+
+static inline bool cpuHasAvx512() {
+    unsigned regs[4];
+    if (!cpuHasXsaveState(0xe6)) {
+        return false;
+    }
+    cpuid(7, 0, regs);
+    return regs[1] & (1u << 16);
+}
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+static inline bool cpuHasNeon() {
+    #if defined(__linux__)
+    return getauxval(AT_HWCAP) & HWCAP_ASIMD;
+    #else
+    return true;
+    #endif
+}
+
+static bool keccakSearchNeon(const Keccak256Miner& job, uint64_t mask, uint64_t start, uint64_t count, uint64_t& nonce) {
+    return keccakSearch<U64x2>(job, mask, start, count, nonce);
+}
+#endif
+
+template <int N>
+static bool keccakSearchMulti(const Keccak256Miner& job, uint64_t mask, uint64_t start, uint64_t count, uint64_t& nonce) {
+    return keccakSearch<U64xN<N>>(job, mask, start, count, nonce);
+}
+
+// Full permutation on the padded template, for the generic implementations.
+template <void (*Permute)(uint8_t*)>
+static bool keccakSearchPermutation(const Keccak256Miner& job, uint64_t mask, uint64_t start, uint64_t count, uint64_t& nonce) {
+    alignas(64) uint64_t state[25];
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t n0, n1;
+        job.nonceLanes(start + i, n0, n1);
+        std::memcpy(state, job.lanes, sizeof(state));
+        state[0] ^= n0;
+        state[1] ^= n1;
+        Permute(reinterpret_cast<uint8_t*>(state));
+        if ((state[0] & mask) == 0) {
+            nonce = start + i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void ref_keccakF1600(uint8_t* state) {
+    KeccakF1600(state);
+}
+
+static bool keccakSearchMidstate(const Keccak256Miner& job, uint64_t mask, uint64_t start, uint64_t count, uint64_t& nonce) {
+    for (uint64_t i = 0; i < count; ++i) {
+        if ((job.head(start + i) & mask) == 0) {
+            nonce = start + i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool alwaysSupported() {
+    return true;
+}
+
+inline const std::vector<KeccakBackend>& keccakBackends() {
+    static const std::vector<KeccakBackend> backends = {
+        #if defined(KECCAK_X86)
+        {"avx512", keccakSearchAvx512, cpuHasAvx512, true},
+        {"avx2", keccakSearchAvx2, cpuHasAvx2, true},
+        #endif
+        #if defined(__ARM_NEON) && defined(__aarch64__)
+        {"neon", keccakSearchNeon, cpuHasNeon, true},
+        #endif
+        {"midstate", keccakSearchMidstate, alwaysSupported, true},
+        {"multi2", keccakSearchMulti<2>, alwaysSupported, true},
+        {"multi3", keccakSearchMulti<3>, alwaysSupported, true},
+        {"int32", keccakSearchInterleaved, alwaysSupported, KECCAK_32BIT != 0},
+        {"opt", keccakSearchPermutation<fast_keccakF1600>, alwaysSupported, true},
+        {"lc", keccakSearchPermutation<lc_keccakF1600>, alwaysSupported, true},
+        {"portable", keccakSearchPermutation<portable_keccakF1600>, alwaysSupported, true},
+        {"ref", keccakSearchPermutation<ref_keccakF1600>, alwaysSupported, false}
+    };
+    return backends;
+}
+
+// Hash rate of a backend on a synthetic job, measured for about `duration`.
+inline double benchmarkKeccakBackend(const KeccakBackend& backend, std::chrono::milliseconds duration) {
+    std::uint8_t data[76];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = static_cast<std::uint8_t>(i * 131 + 7);
+    }
+    Keccak256Miner job;
+    job.init(data, sizeof(data), 4);
+    const uint64_t chunk = 1024;
+    uint64_t nonce = 0, hashes = 0, found = 0;
+    backend.search(job, ~0ULL, nonce, chunk, found);
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed(0);
+    while (elapsed < duration) {
+        backend.search(job, ~0ULL, nonce, chunk, found);
+        nonce += chunk;
+        hashes += chunk;
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    return hashes / elapsed.count();
+}
+
+// Resolves a backend by name, or benchmarks the supported ones for "auto". Returns nullptr
+// if the name is unknown or the host lacks the required instruction set.
+inline const KeccakBackend* selectKeccakBackend(const std::string& name, bool verbose) {
+    const KeccakBackend* selected = nullptr;
+    if (name != "auto") {
+        for (const auto& backend : keccakBackends()) {
+            if (name == backend.name && backend.supported()) {
+                selected = &backend;
+            }
+        }
+        return selected;
+    }
+    double bestRate = 0;
+    for (const auto& backend : keccakBackends()) {
+        if (!backend.autotune || !backend.supported()) {
+            continue;
+        }
+        double rate = benchmarkKeccakBackend(backend, std::chrono::milliseconds(30));
+        if (verbose) {
+            std::cout << "[CPU] Keccak autotune: " << std::left << std::setw(9) << backend.name
+                      << std::fixed << std::setprecision(2) << rate / 1e6 << " MH/s" << std::endl;
+        }
+        if (rate > bestRate) {
+            bestRate = rate;
+            selected = &backend;
+        }
+    }
+    return selected;
+}
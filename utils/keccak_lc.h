@@ -0,0 +1,125 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Lane-complementing Keccak-f[1600] permutation (KECCAK=LC, --keccak lc). The 24 rounds are
+    expanded by template recursion with rho/pi resolved from constexpr tables, so the lanes
+    live in fixed-index locals the compiler keeps in registers, ping-ponging between two states.
+    Lanes 1, 2, 8, 12, 17 and 20 are stored complemented (the Keccak team's "bebigokimisa"
+    pattern), which turns most chi NOTs into ORs: 5 NOTs per round instead of 25.
+    Reference: Keccak implementation overview (https://keccak.team/files/Keccak-implementation-3.2.pdf)
+*/
+
+#pragma once
+
+#include <cstring>
+
+// Lane (5y + x) of the rho/pi output: source lane and rotation.
+static constexpr int lcSource[25] = {
+    0, 6, 12, 18, 24, 3, 9, 10, 16, 22, 1, 7, 13, 19, 20, 4, 5, 11, 17, 23, 2, 8, 14, 15, 21
+};
+static constexpr int lcRho[25] = {
+    0, 44, 43, 21, 14, 28, 20, 3, 45, 61, 1, 6, 25, 8, 18, 27, 36, 10, 15, 56, 62, 55, 39, 41, 2
+};
+static constexpr int lcComplemented[6] = {1, 2, 8, 12, 17, 20};
+
+static constexpr uint64_t lcRoundConstants[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+template <int N>
+static INLINE uint64_t lcRotl(uint64_t x) {
+    if constexpr (N == 0) {
+        return x;
+    } else {
+        return (x << N) | (x >> (64 - N));
+    }
+}
+
+// Lane I of the rho/pi output, from the theta effect d.
+template <int I>
+static INLINE uint64_t lcLane(const uint64_t* RESTRICT a, const uint64_t* d) {
+    return lcRotl<lcRho[I]>(a[lcSource[I]] ^ d[lcSource[I] % 5]);
+}
+
+// One round from a to e, on complemented lanes in and out. Each chi row is computed right
+// after its five rho/pi lanes to keep register pressure to one row.
+template <int R>
+static INLINE void lcRound(const uint64_t* RESTRICT a, uint64_t* RESTRICT e) {
+    const uint64_t c0 = a[0] ^ a[5] ^ a[10] ^ a[15] ^ a[20];
+    const uint64_t c1 = a[1] ^ a[6] ^ a[11] ^ a[16] ^ a[21];
+    const uint64_t c2 = a[2] ^ a[7] ^ a[12] ^ a[17] ^ a[22];
+    const uint64_t c3 = a[3] ^ a[8] ^ a[13] ^ a[18] ^ a[23];
+    const uint64_t c4 = a[4] ^ a[9] ^ a[14] ^ a[19] ^ a[24];
+    const uint64_t d[5] = {c4 ^ lcRotl<1>(c1), c0 ^ lcRotl<1>(c2), c1 ^ lcRotl<1>(c3), c2 ^ lcRotl<1>(c4), c3 ^ lcRotl<1>(c0)};
+    {
+        const uint64_t b0 = lcLane<0>(a, d), b1 = lcLane<1>(a, d), b2 = lcLane<2>(a, d), b3 = lcLane<3>(a, d), b4 = lcLane<4>(a, d);
+        e[0] = b0 ^ (b1 | b2) ^ lcRoundConstants[R];
+        e[1] = b1 ^ (~b2 | b3);
+        e[2] = b2 ^ (b3 & b4);
+        e[3] = b3 ^ (b4 | b0);
+        e[4] = b4 ^ (b0 & b1);
+    }
+    {
+        const uint64_t b0 = lcLane<5>(a, d), b1 = lcLane<6>(a, d), b2 = lcLane<7>(a, d), b3 = lcLane<8>(a, d), b4 = lcLane<9>(a, d);
+        e[5] = b0 ^ (b1 | b2);
+        e[6] = b1 ^ (b2 & b3);
+        e[7] = b2 ^ (b3 | ~b4);
+        e[8] = b3 ^ (b4 | b0);
+        e[9] = b4 ^ (b0 & b1);
+    }
+    {
+        const uint64_t b0 = lcLane<10>(a, d), b1 = lcLane<11>(a, d), b2 = lcLane<12>(a, d), b3 = lcLane<13>(a, d), b4 = lcLane<14>(a, d);
+        const uint64_t n3 = ~b3;
+        e[10] = b0 ^ (b1 | b2);
+        e[11] = b1 ^ (b2 & b3);
+        e[12] = b2 ^ (n3 & b4);
+        e[13] = n3 ^ (b4 | b0);
+        e[14] = b4 ^ (b0 & b1);
+    }
+    {
+        const uint64_t b0 = lcLane<15>(a, d), b1 = lcLane<16>(a, d), b2 = lcLane<17>(a, d), b3 = lcLane<18>(a, d), b4 = lcLane<19>(a, d);
+        const uint64_t n3 = ~b3;
+        e[15] = b0 ^ (b1 & b2);
+        e[16] = b1 ^ (b2 | b3);
+        e[17] = b2 ^ (n3 | b4);
+        e[18] = n3 ^ (b4 & b0);
+        e[19] = b4 ^ (b0 | b1);
+    }
+    {
+        const uint64_t b0 = lcLane<20>(a, d), b1 = lcLane<21>(a, d), b2 = lcLane<22>(a, d), b3 = lcLane<23>(a, d), b4 = lcLane<24>(a, d);
+        const uint64_t n1 = ~b1;
+        e[20] = b0 ^ (n1 & b2);
+        e[21] = n1 ^ (b2 | b3);
+        e[22] = b2 ^ (b3 & b4);
+        e[23] = b3 ^ (b4 | b0);
+        e[24] = b4 ^ (b0 & b1);
+    }
+}
+
+template <int R>
+static INLINE void lcRounds(uint64_t* RESTRICT a, uint64_t* RESTRICT e) {
+    if constexpr (R < 24) {
+        lcRound<R>(a, e);
+        lcRounds<R + 1>(e, a);
+    }
+}
+
+static INLINE void lc_keccakF1600(uint8_t* state) {
+    uint64_t a[25], e[25];
+    std::memcpy(a, state, sizeof(a));
+    for (int lane : lcComplemented)
+        a[lane] = ~a[lane];
+    lcRounds<0>(a, e);
+    for (int lane : lcComplemented)
+        a[lane] = ~a[lane];
+    std::memcpy(state, a, sizeof(a));
+}
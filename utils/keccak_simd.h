@@ -0,0 +1,195 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Multi-nonce Keccak-f[1600] lanes for the mining engine: each vector holds the same lane
+    of independent states (AVX-512: 8, AVX2: 4, NEON: 2, scalar multi-buffer: 2 or 3) so
+    consecutive nonces are hashed together.
+    x86 kernels are compiled in their own translation units (keccak_avx2.cpp, keccak_avx512.cpp)
+    and selected at runtime, see keccak_dispatch.h.
+*/
+
+#pragma once
+
+#include "keccak.h"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#if defined(__AVX512F__)
+struct U64x8 {
+    static constexpr int width = 8;
+    __m512i v;
+    U64x8() = default;
+    explicit U64x8(__m512i x) : v(x) {}
+    explicit U64x8(uint64_t x) : v(_mm512_set1_epi64(static_cast<long long>(x))) {}
+    static INLINE U64x8 load(const uint64_t* p) { return U64x8(_mm512_loadu_si512(p)); }
+};
+
+static INLINE U64x8 operator^(const U64x8& a, const U64x8& b) { return U64x8(_mm512_xor_si512(a.v, b.v)); }
+
+template <int N>
+static INLINE U64x8 laneRotl(const U64x8& x) { return U64x8(_mm512_rol_epi64(x.v, N)); }
+
+static INLINE U64x8 laneChi(const U64x8& a, const U64x8& b, const U64x8& c) {
+    return U64x8(_mm512_ternarylogic_epi64(a.v, b.v, c.v, 0xD2));
+}
+
+static INLINE unsigned laneZeros(const U64x8& x, const U64x8& mask) {
+    return _mm512_testn_epi64_mask(x.v, mask.v);
+}
+#endif
+
+#if defined(__AVX2__)
+struct U64x4 {
+    static constexpr int width = 4;
+    __m256i v;
+    U64x4() = default;
+    explicit U64x4(__m256i x) : v(x) {}
+    explicit U64x4(uint64_t x) : v(_mm256_set1_epi64x(static_cast<long long>(x))) {}
+    static INLINE U64x4 load(const uint64_t* p) { return U64x4(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))); }
+};
+
+static INLINE U64x4 operator^(const U64x4& a, const U64x4& b) { return U64x4(_mm256_xor_si256(a.v, b.v)); }
+
+template <int N>
+static INLINE U64x4 laneRotl(const U64x4& x) {
+    return U64x4(_mm256_or_si256(_mm256_slli_epi64(x.v, N), _mm256_srli_epi64(x.v, 64 - N)));
+}
+
+static INLINE U64x4 laneChi(const U64x4& a, const U64x4& b, const U64x4& c) {
+    return U64x4(_mm256_xor_si256(a.v, _mm256_andnot_si256(b.v, c.v)));
+}
+
+static INLINE unsigned laneZeros(const U64x4& x, const U64x4& mask) {
+    const __m256i zero = _mm256_cmpeq_epi64(_mm256_and_si256(x.v, mask.v), _mm256_setzero_si256());
+    return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(zero)));
+}
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+struct U64x2 {
+    static constexpr int width = 2;
+    uint64x2_t v;
+    U64x2() = default;
+    explicit U64x2(uint64x2_t x) : v(x) {}
+    explicit U64x2(uint64_t x) : v(vdupq_n_u64(x)) {}
+    static INLINE U64x2 load(const uint64_t* p) { return U64x2(vld1q_u64(p)); }
+};
+
+static INLINE U64x2 operator^(const U64x2& a, const U64x2& b) { return U64x2(veorq_u64(a.v, b.v)); }
+
+template <int N>
+static INLINE U64x2 laneRotl(const U64x2& x) { return U64x2(vsriq_n_u64(vshlq_n_u64(x.v, N), x.v, 64 - N)); }
+
+static INLINE U64x2 laneChi(const U64x2& a, const U64x2& b, const U64x2& c) {
+    #if defined(__ARM_FEATURE_SHA3)
+    return U64x2(vbcaxq_u64(a.v, c.v, b.v));
+    #else
+    return U64x2(veorq_u64(a.v, vbicq_u64(c.v, b.v)));
+    #endif
+}
+
+static INLINE unsigned laneZeros(const U64x2& x, const U64x2& mask) {
+    const uint64x2_t zero = vceqzq_u64(vandq_u64(x.v, mask.v));
+    return static_cast<unsigned>((vgetq_lane_u64(zero, 0) & 1) | ((vgetq_lane_u64(zero, 1) & 1) << 1));
+}
+#endif
+
+// Scalar multi-buffer lanes: N independent nonces in general-purpose registers, interleaved
+// operation by operation so wide out-of-order cores overlap their dependency chains. Needs no
+// SIMD; N is 2 or 3 (more states than that spill on 16-register targets).
+template <int N>
+struct U64xN {
+    static constexpr int width = N;
+    uint64_t v[N];
+    U64xN() = default;
+    explicit U64xN(uint64_t x) {
+        for (int i = 0; i < N; ++i)
+            v[i] = x;
+    }
+    static INLINE U64xN load(const uint64_t* p) {
+        U64xN r;
+        for (int i = 0; i < N; ++i)
+            r.v[i] = p[i];
+        return r;
+    }
+};
+
+template <int N>
+static INLINE U64xN<N> operator^(const U64xN<N>& a, const U64xN<N>& b) {
+    U64xN<N> r;
+    for (int i = 0; i < N; ++i)
+        r.v[i] = a.v[i] ^ b.v[i];
+    return r;
+}
+
+template <int K, int N>
+static INLINE U64xN<N> laneRotl(const U64xN<N>& x) {
+    U64xN<N> r;
+    for (int i = 0; i < N; ++i)
+        r.v[i] = laneRotl<K>(x.v[i]);
+    return r;
+}
+
+template <int N>
+static INLINE U64xN<N> laneChi(const U64xN<N>& a, const U64xN<N>& b, const U64xN<N>& c) {
+    U64xN<N> r;
+    for (int i = 0; i < N; ++i)
+        r.v[i] = a.v[i] ^ (~b.v[i] & c.v[i]);
+    return r;
+}
+
+// Combined difficulty check: one bit per nonce whose head has all `mask` bits clear.
+template <int N>
+static INLINE unsigned laneZeros(const U64xN<N>& x, const U64xN<N>& mask) {
+    unsigned hits = 0;
+    for (int i = 0; i < N; ++i)
+        hits |= static_cast<unsigned>((x.v[i] & mask.v[i]) == 0) << i;
+    return hits;
+}
+
+// Hashes [start, start + count) V::width nonces at a time. Returns true with the first nonce whose
+// first digest lane has all `mask` bits clear; the caller confirms it on the full digest.
+template <typename V>
+static INLINE bool keccakSearch(const Keccak256Miner& job, uint64_t mask, uint64_t start, uint64_t count, uint64_t& nonce) {
+    constexpr int width = V::width;
+    V lanes[25], theta[7], roundConstants[24];
+    for (int i = 0; i < 25; ++i)
+        lanes[i] = V(job.lanes[i]);
+    for (int i = 0; i < 7; ++i)
+        theta[i] = V(job.theta[i]);
+    for (int i = 0; i < 24; ++i)
+        roundConstants[i] = V(Keccak256Miner::roundConstants[i]);
+    const V headMask(mask);
+
+    alignas(64) uint64_t n0[width], n1[width];
+    for (uint64_t offset = 0; offset < count; offset += width) {
+        for (int i = 0; i < width; ++i) {
+            const uint64_t bytes = BSWAP64(start + offset + i);
+            n0[i] = bytes << job.shift;
+            n1[i] = bytes >> (64 - job.shift);
+        }
+        const V head = keccakHead<V>(lanes, theta, roundConstants, V::load(n0), V::load(n1));
+        unsigned hits = laneZeros(head, headMask);
+        if (count - offset < static_cast<uint64_t>(width)) {
+            hits &= (1u << (count - offset)) - 1;
+        }
+        if (hits) {
+            for (int i = 0; i < width; ++i) {
+                if (hits & (1u << i)) {
+                    nonce = start + offset + i;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
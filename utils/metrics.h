@@ -0,0 +1,352 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Mining metrics in the Prometheus text exposition format. Hash counters and batch durations
+    live in cache-line-padded per-thread slots written only by their owner; the exporter sums
+    them per device and serves the result on a local HTTP port or rewrites a file every second.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Cumulative histogram with fixed upper bounds (seconds).
+class Histogram {
+    public:
+        explicit Histogram(std::vector<double> upperBounds)
+            : bounds(std::move(upperBounds)), counts(new std::atomic<std::uint64_t>[bounds.size() + 1]) {
+            for (size_t i = 0; i <= bounds.size(); ++i) {
+                counts[i].store(0);
+            }
+        }
+
+        void observe(double seconds) {
+            size_t bucket = 0;
+            while (bucket < bounds.size() && seconds > bounds[bucket]) {
+                bucket++;
+            }
+            counts[bucket].fetch_add(1, std::memory_order_relaxed);
+            nanoseconds.fetch_add(static_cast<std::uint64_t>(seconds * 1e9), std::memory_order_relaxed);
+        }
+
+        // Adds this histogram into `total`, which must have the same bounds.
+        void accumulate(std::vector<std::uint64_t>& total, std::uint64_t& sum) const {
+            total.resize(bounds.size() + 1, 0);
+            for (size_t i = 0; i <= bounds.size(); ++i) {
+                total[i] += counts[i].load(std::memory_order_relaxed);
+            }
+            sum += nanoseconds.load(std::memory_order_relaxed);
+        }
+
+        const std::vector<double>& upperBounds() const { return bounds; }
+
+    private:
+        std::vector<double> bounds;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> counts;
+        std::atomic<std::uint64_t> nanoseconds{0};
+};
+
+class Metrics {
+    public:
+        // One slot per mining thread, labelled with its device ("cpu", "gpu0", ...) and its
+        // index on that device. Must be called before the threads start.
+        void init(const std::vector<std::string>& devices) {
+            std::vector<Slot> created;
+            created.reserve(devices.size());
+            std::vector<std::string> seen;
+            for (const auto& device : devices) {
+                size_t index = 0;
+                for (const auto& name : seen) {
+                    index += name == device;
+                }
+                seen.push_back(device);
+                created.emplace_back(device, index);
+            }
+            slots = std::move(created);
+        }
+
+        // Owner-only updates: a plain load/store pair, no locked instruction in the hot loop.
+        void addHashes(size_t thread, std::uint64_t count) {
+            auto& hashes = slots[thread].hashes;
+            hashes.store(hashes.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+        }
+
+        void observeBatch(size_t thread, double seconds) {
+            slots[thread].batches.observe(seconds);
+        }
+
+        void observeFirstSolution(double seconds) { firstSolution.observe(seconds); }
+        void observeJobSwitch(double seconds) { jobSwitch.observe(seconds); }
+
+        std::uint64_t hashes(size_t thread) const {
+            return slots[thread].hashes.load(std::memory_order_relaxed);
+        }
+
+        std::uint64_t totalHashes() const {
+            std::uint64_t total = 0;
+            for (const auto& slot : slots) {
+                total += slot.hashes.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        // Updates the per-thread hash rate gauges from the counters since the previous sample.
+        void sample() {
+            const auto now = std::chrono::steady_clock::now();
+            const double elapsed = std::chrono::duration<double>(now - sampled).count();
+            sampled = now;
+            for (auto& slot : slots) {
+                const std::uint64_t hashes = slot.hashes.load(std::memory_order_relaxed);
+                slot.rate.store(elapsed > 0 ? (hashes - slot.sampledHashes) / elapsed : 0, std::memory_order_relaxed);
+                slot.sampledHashes = hashes;
+            }
+        }
+
+        std::string render() const {
+            std::ostringstream out;
+            out << "# HELP kale_hashes_total Hashes computed per mining thread.\n"
+                << "# TYPE kale_hashes_total counter\n";
+            for (const auto& slot : slots) {
+                out << "kale_hashes_total" << slot.labels << " " << slot.hashes.load(std::memory_order_relaxed) << "\n";
+            }
+            out << "# HELP kale_hash_rate Hash rate per mining thread over the last second.\n"
+                << "# TYPE kale_hash_rate gauge\n";
+            for (const auto& slot : slots) {
+                out << "kale_hash_rate" << slot.labels << " " << slot.rate.load(std::memory_order_relaxed) << "\n";
+            }
+            out << "# HELP kale_device_hash_rate Hash rate per device over the last second.\n"
+                << "# TYPE kale_device_hash_rate gauge\n";
+            for (const auto& device : devices()) {
+                double rate = 0;
+                for (const auto& slot : slots) {
+                    rate += slot.device == device ? slot.rate.load(std::memory_order_relaxed) : 0;
+                }
+                out << "kale_device_hash_rate{device=\"" << device << "\"} " << rate << "\n";
+            }
+            out << "# HELP kale_batch_duration_seconds Duration of one nonce batch (CPU chunk or GPU kernel launch).\n"
+                << "# TYPE kale_batch_duration_seconds histogram\n";
+            for (const auto& device : devices()) {
+                std::vector<std::uint64_t> counts;
+                std::uint64_t sum = 0;
+                for (const auto& slot : slots) {
+                    if (slot.device == device) {
+                        slot.batches.accumulate(counts, sum);
+                    }
+                }
+                writeHistogram(out, "kale_batch_duration_seconds", "device=\"" + device + "\",", batchBounds(), counts, sum);
+            }
+            out << "# HELP kale_first_solution_seconds Time from job start to its first solution.\n"
+                << "# TYPE kale_first_solution_seconds histogram\n";
+            writeHistogram(out, "kale_first_solution_seconds", "", firstSolution);
+            out << "# HELP kale_job_switch_seconds Time for a worker to leave a replaced job.\n"
+                << "# TYPE kale_job_switch_seconds histogram\n";
+            writeHistogram(out, "kale_job_switch_seconds", "", jobSwitch);
+            return out.str();
+        }
+
+    private:
+        static std::vector<double> batchBounds() {
+            return {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+        }
+
+        struct alignas(64) Slot {
+            Slot(const std::string& device, size_t index)
+                : device(device), labels("{device=\"" + device + "\",thread=\"" + std::to_string(index) + "\"}"),
+                  batches(batchBounds()) {}
+            Slot(Slot&& other)
+                : device(other.device), labels(other.labels), batches(batchBounds()) {}
+            std::atomic<std::uint64_t> hashes{0};
+            std::atomic<double> rate{0};
+            std::uint64_t sampledHashes = 0;
+            std::string device;
+            std::string labels;
+            Histogram batches;
+        };
+
+        std::vector<std::string> devices() const {
+            std::vector<std::string> names;
+            for (const auto& slot : slots) {
+                if (names.empty() || names.back() != slot.device) {
+                    names.push_back(slot.device);
+                }
+            }
+            return names;
+        }
+
+        static void writeHistogram(std::ostringstream& out, const std::string& name, const std::string& labels,
+            const Histogram& histogram) {
+            std::vector<std::uint64_t> counts;
+            std::uint64_t sum = 0;
+            histogram.accumulate(counts, sum);
+            writeHistogram(out, name, labels, histogram.upperBounds(), counts, sum);
+        }
+
+        static void writeHistogram(std::ostringstream& out, const std::string& name, const std::string& labels,
+            const std::vector<double>& bounds, std::vector<std::uint64_t> counts, std::uint64_t sum) {
+            counts.resize(bounds.size() + 1, 0);
+            std::uint64_t cumulative = 0;
+            for (size_t i = 0; i <= bounds.size(); ++i) {
+                cumulative += counts[i];
+                out << name << "_bucket{" << labels << "le=\"";
+                if (i < bounds.size()) {
+                    out << bounds[i];
+                } else {
+                    out << "+Inf";
+                }
+                out << "\"} " << cumulative << "\n";
+            }
+            const std::string suffix = labels.empty() ? "" : "{" + labels.substr(0, labels.size() - 1) + "}";
+            out << name << "_sum" << suffix << " " << sum / 1e9 << "\n"
+                << name << "_count" << suffix << " " << cumulative << "\n";
+        }
+
+        std::vector<Slot> slots;
+        std::chrono::steady_clock::time_point sampled = std::chrono::steady_clock::now();
+        Histogram firstSolution{{0.01, 0.1, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600}};
+        Histogram jobSwitch{{0.00001, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.05, 0.1}};
+};
+
+// Publishes `metrics` every second: a numeric target is a TCP port served on 127.0.0.1
+// (any request path returns the metrics), anything else a file rewritten atomically.
+class MetricsExporter {
+    public:
+        MetricsExporter(Metrics& metrics, const std::string& target) : metrics(metrics) {
+            const bool port = !target.empty() && target.find_first_not_of("0123456789") == std::string::npos;
+            if (port) {
+#if defined(_WIN32)
+                throw std::runtime_error("Metrics HTTP endpoint is not supported on this platform, use a file.");
+#else
+                server = socket(AF_INET, SOCK_STREAM, 0);
+                sockaddr_in address{};
+                address.sin_family = AF_INET;
+                address.sin_port = htons(static_cast<std::uint16_t>(std::stoi(target)));
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                int reuse = 1;
+                setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+                if (server < 0 || bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+                    || listen(server, 8) < 0) {
+                    if (server >= 0) {
+                        close(server);
+                    }
+                    throw std::runtime_error("Failed to serve metrics on port " + target + ".");
+                }
+                thread = std::thread([this]() { serve(); });
+#endif
+            } else {
+                path = target;
+                thread = std::thread([this]() { writeFile(); });
+            }
+        }
+
+        ~MetricsExporter() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            stopped.notify_all();
+            thread.join();
+#if !defined(_WIN32)
+            if (server >= 0) {
+                close(server);
+            }
+#endif
+        }
+
+        MetricsExporter(const MetricsExporter&) = delete;
+        MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    private:
+        // Samples the rate gauges once per second; returns false when stopping.
+        bool tick(std::chrono::steady_clock::time_point& next) {
+            if (std::chrono::steady_clock::now() >= next) {
+                metrics.sample();
+                next += std::chrono::seconds(1);
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            return !stopping;
+        }
+
+        void writeFile() {
+            auto next = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            bool running = true;
+            while (running) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    stopped.wait_until(lock, next, [this]() { return stopping; });
+                }
+                // The last write after stopping keeps the final counters.
+                running = tick(next);
+                const std::string temp = path + ".tmp";
+                if (FILE* file = std::fopen(temp.c_str(), "w")) {
+                    const std::string text = metrics.render();
+                    std::fwrite(text.data(), 1, text.size(), file);
+                    std::fclose(file);
+                    std::rename(temp.c_str(), path.c_str());
+                }
+            }
+        }
+
+#if !defined(_WIN32)
+        void serve() {
+            auto next = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (tick(next)) {
+                pollfd fd{server, POLLIN, 0};
+                if (poll(&fd, 1, 100) <= 0) {
+                    continue;
+                }
+                int client = accept(server, nullptr, nullptr);
+                if (client < 0) {
+                    continue;
+                }
+                // The request itself is not needed; drain what has arrived.
+                char request[1024];
+                pollfd in{client, POLLIN, 0};
+                if (poll(&in, 1, 100) > 0) {
+                    (void)recv(client, request, sizeof(request), 0);
+                }
+                const std::string body = metrics.render();
+                const std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+                for (size_t sent = 0; sent < response.size();) {
+                    ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                    if (n <= 0) {
+                        break;
+                    }
+                    sent += static_cast<size_t>(n);
+                }
+                close(client);
+            }
+        }
+#endif
+
+        Metrics& metrics;
+        std::string path;
+        int server = -1;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable stopped;
+        bool stopping = false;
+};
@@ -0,0 +1,378 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    CPU mining core shared by the miner front ends and the benchmarks: message preparation,
+    difficulty checks, the job state and the find() worker loop.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "keccak.h"
+#include "keccak_dispatch.h"
+#include "misc.h"
+#include "channel.h"
+#include "scheduler.h"
+#include "checkpoint.h"
+#include "metrics.h"
+#include "trace.h"
+
+// Process-wide mining metrics (see --metrics).
+inline Metrics metrics;
+
+inline bool check(const std::vector<std::uint8_t>& hash, int difficulty) {
+    int zeros = 0;
+    for (std::uint8_t byte : hash) {
+        zeros += (byte == 0) ? 2 : ((byte >> 4) == 0 ? 1 : 0);
+        if (byte != 0 || zeros >= difficulty)
+            break;
+    }
+    return zeros >= difficulty;
+}
+
+typedef std::array<std::uint8_t, 32> Digest;
+
+// Digest word `i` read big-endian, so leading nibbles are its most significant bits.
+inline std::uint64_t digestWord(const std::uint8_t* digest, int i) {
+    std::uint64_t word;
+    std::memcpy(&word, digest + 8 * i, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return word;
+#else
+    return BSWAP64(word);
+#endif
+}
+
+inline int countLeadingZeros64(std::uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    return _BitScanReverse64(&index, x) ? 63 - static_cast<int>(index) : 64;
+#else
+    return x ? __builtin_clzll(x) : 64;
+#endif
+}
+
+// Leading zero nibbles of a 32-byte digest: one count-leading-zeros per non-zero word.
+inline int zeroNibbles(const std::uint8_t* digest) {
+    for (int i = 0; i < 4; ++i) {
+        if (const std::uint64_t word = digestWord(digest, i)) {
+            return i * 16 + countLeadingZeros64(word) / 4;
+        }
+    }
+    return 64;
+}
+
+inline int zeroNibbles(const std::vector<std::uint8_t>& hash) {
+    return zeroNibbles(hash.data());
+}
+
+// Difficulty check with the word count and threshold fixed at compile time: the fully zero
+// words must be zero and the next one below 16^(16 - remaining nibbles).
+template <int Difficulty>
+inline bool meetsDifficulty(const std::uint8_t* digest) {
+    constexpr int words = Difficulty / 16;
+    for (int i = 0; i < words; ++i) {
+        if (digestWord(digest, i)) {
+            return false;
+        }
+    }
+    if constexpr (Difficulty % 16 != 0) {
+        return digestWord(digest, words) < (1ULL << (64 - 4 * (Difficulty % 16)));
+    }
+    return true;
+}
+
+typedef bool (*DifficultyCheck)(const std::uint8_t* digest);
+
+template <size_t... Difficulty>
+inline DifficultyCheck difficultyCheck(int difficulty, std::index_sequence<Difficulty...>) {
+    static constexpr DifficultyCheck checks[] = {&meetsDifficulty<static_cast<int>(Difficulty)>...};
+    return checks[difficulty];
+}
+
+// Check for `difficulty` (0 to 64 nibbles), selected once per job.
+inline DifficultyCheck difficultyCheck(int difficulty) {
+    if (difficulty < 0 || difficulty > 64) {
+        throw std::invalid_argument("Difficulty must be between 0 and 64.");
+    }
+    return difficultyCheck(difficulty, std::make_index_sequence<65>());
+}
+
+// Bits of the first digest lane (little-endian) that must be zero for the leading nibbles
+// of the difficulty; candidates are confirmed on the full digest with the job's difficulty check.
+inline std::uint64_t headMask(int difficulty) {
+    std::uint64_t mask = 0;
+    for (int i = 0; i < difficulty && i < 16; ++i) {
+        mask |= 0xfULL << ((i / 2) * 8 + ((i & 1) ? 0 : 4));
+    }
+    return mask;
+}
+
+inline std::vector<std::uint8_t> prepare(std::uint32_t block, std::uint64_t nonce,
+    const std::string& base64Hash, const std::string& miner, size_t& nonceOffset
+) {
+    TRACE_SPAN("prepare");
+    auto blockXdr = i32ToBytes(block);
+    auto nonceXdr = i64ToBytes(nonce);
+    auto entropy = base64Decode(base64Hash);
+    auto minerXdr = addressToXdr(miner);
+    std::vector<std::uint8_t> truncated(minerXdr.end() - 32, minerXdr.end());
+    std::vector<std::uint8_t> data;
+    data.reserve(
+        blockXdr.size() +
+        nonceXdr.size() +
+        entropy.size() +
+        truncated.size()
+    );
+    data.insert(data.end(), blockXdr.begin(), blockXdr.end());
+    data.insert(data.end(), nonceXdr.begin(), nonceXdr.end());
+    data.insert(data.end(), entropy.begin(), entropy.end());
+    data.insert(data.end(), truncated.begin(), truncated.end());
+    nonceOffset = blockXdr.size();
+    return data;
+}
+
+// A prepared CPU job shared by the workers. `stop` is raised when the job is solved or replaced.
+struct MiningJob {
+    MiningJob(size_t workers, std::uint64_t start, std::uint64_t batchSize, std::uint64_t chunkSize,
+        std::shared_ptr<NonceJournal> checkpoint, std::uint64_t end = UINT64_MAX)
+        : journal(std::move(checkpoint)), scheduler(workers, start, end, batchSize, chunkSize, journal.get()) {}
+    std::shared_ptr<NonceJournal> journal;
+    bool resumed = false;
+    std::string id;
+    std::uint32_t block = 0;
+    int difficulty = 0;
+    std::uint64_t mask = 0;
+    DifficultyCheck meets = nullptr;
+    Keccak256Miner engine;
+    NonceScheduler scheduler;
+    std::shared_ptr<LineChannel> channel;
+    // Per-worker chunk sizes (--auto-tune), shared across jobs; null keeps the scheduler's chunk size.
+    RateBalancer* tuner = nullptr;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> solved{false};
+    std::atomic<std::uint64_t> hashes{0};
+    const std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now();
+    // Steady-clock nanoseconds when the job was replaced (0: never), for job-switch latency.
+    std::atomic<std::int64_t> replaced{0};
+    std::vector<std::uint8_t> digest;
+    std::uint64_t nonce = 0;
+    // Best-so-far mode: keep searching after a solution and report each improvement.
+    bool best = false;
+    std::atomic<int> bestZeros{-1};
+    int recordedZeros = -1;
+    std::mutex bestMutex;
+    std::function<void(const MiningJob&)> improved;
+};
+
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline void record(MiningJob& job) {
+    if (job.journal) {
+        job.journal->nonce.store(job.nonce, std::memory_order_release);
+        job.journal->zeros.store(zeroNibbles(job.digest), std::memory_order_release);
+    }
+}
+
+// Raises the job's best with a lock-free CAS on bestZeros, so only real improvements reach
+// the mutex that records the digest and reports it in order.
+inline void improve(MiningJob& job, const std::uint8_t* digest, std::uint64_t nonce, int zeros) {
+    int best = job.bestZeros.load(std::memory_order_relaxed);
+    while (zeros > best) {
+        if (job.bestZeros.compare_exchange_weak(best, zeros, std::memory_order_acq_rel)) {
+            std::lock_guard<std::mutex> lock(job.bestMutex);
+            if (zeros > job.recordedZeros) {
+                TRACE_SPAN("publish", nonce);
+                if (job.recordedZeros < 0) {
+                    metrics.observeFirstSolution(secondsSince(job.created));
+                }
+                job.recordedZeros = zeros;
+                job.digest.assign(digest, digest + 32);
+                job.nonce = nonce;
+                record(job);
+                job.solved.store(true);
+                if (job.improved) {
+                    job.improved(job);
+                }
+            }
+            return;
+        }
+    }
+}
+
+// Message and Keccak template of a job. The miner key is the last 32 bytes of the message, so
+// jobs of several miners decode the entropy and build the template once and only patch the key.
+struct JobTemplate {
+    JobTemplate(std::uint32_t block, std::uint64_t nonce, const std::string& hash, const std::string& miner)
+        : block(block), nonce(nonce), data(prepare(block, nonce, hash, miner, nonceOffset)) {
+        engine.init(data.data(), data.size(), nonceOffset);
+    }
+
+    void setMiner(const std::string& miner) {
+        const std::vector<std::uint8_t> minerXdr = addressToXdr(miner);
+        const size_t offset = data.size() - 32;
+        std::copy(minerXdr.end() - 32, minerXdr.end(), data.begin() + offset);
+        engine.patch(offset, data.data() + offset, 32);
+    }
+
+    std::uint32_t block;
+    std::uint64_t nonce;
+    size_t nonceOffset = 0;
+    std::vector<std::uint8_t> data;
+    Keccak256Miner engine;
+};
+
+// With a checkpoint, the job is keyed by its message (nonce excluded) and difficulty, and
+// resumes the recorded search when it covers the template's nonce. The search ends before `end`.
+// Without one, a given `journal` (cursor at the template's nonce) tracks the searched prefix.
+inline std::shared_ptr<MiningJob> makeJob(const JobTemplate& base, int difficulty, size_t workers, std::uint64_t batchSize,
+    std::uint64_t chunkSize, Checkpoint* checkpoint = nullptr, std::uint64_t end = UINT64_MAX,
+    std::shared_ptr<NonceJournal> journal = nullptr) {
+    const std::vector<std::uint8_t>& data = base.data;
+    const size_t nonceOffset = base.nonceOffset;
+    const std::uint64_t nonce = base.nonce;
+    bool resumed = false;
+    if (checkpoint) {
+        std::vector<std::uint8_t> key = data;
+        std::fill(key.begin() + nonceOffset, key.begin() + nonceOffset + 8, 0);
+        key.push_back(static_cast<std::uint8_t>(difficulty));
+        journal = checkpoint->journal(fnv1a(key.data(), key.size()), nonce, resumed);
+    }
+    auto job = std::make_shared<MiningJob>(workers, nonce, batchSize, chunkSize, journal, end);
+    job->resumed = resumed;
+    job->block = base.block;
+    job->difficulty = difficulty;
+    job->mask = headMask(difficulty);
+    job->meets = difficultyCheck(difficulty);
+    job->engine = base.engine;
+    return job;
+}
+
+inline std::shared_ptr<MiningJob> makeJob(std::uint32_t block, const std::string& hash, std::uint64_t nonce, int difficulty,
+    const std::string& miner, size_t workers, std::uint64_t batchSize, std::uint64_t chunkSize,
+    Checkpoint* checkpoint = nullptr, std::uint64_t end = UINT64_MAX) {
+    return makeJob(JobTemplate(block, nonce, hash, miner), difficulty, workers, batchSize, chunkSize, checkpoint, end);
+}
+
+// Worker loop: hashes the chunks handed out by the job scheduler until the job stops, the
+// worker is preempted or the range is exhausted. Cancellation is checked once per chunk and the
+// first valid result is claimed with a CAS. Returns true for the worker that published the solution.
+// Nothing is allocated until a solution is published.
+template <typename Preempt>
+inline bool find(size_t worker, MiningJob& job, const KeccakBackend& keccak, bool verbose, Preempt preempted) {
+    // Worker-local copy of the job state, first touched after pinning so it lands on the worker's NUMA node.
+    const Keccak256Miner engine = job.engine;
+    const DifficultyCheck meets = job.meets;
+    std::uint64_t nonce = 0, count = 0, mask = job.mask;
+    Digest digest;
+    bool leased = false;
+    if (job.tuner) {
+        job.scheduler.resize(worker, job.tuner->size(worker));
+    }
+    while (!job.stop.load(std::memory_order_relaxed) && !preempted() && job.scheduler.next(worker, nonce, count, leased)) {
+        const auto started = std::chrono::steady_clock::now();
+        const std::uint64_t chunk = count;
+        TRACE_SPAN("batch", nonce);
+        if (job.best) {
+            mask = headMask(std::max(job.difficulty, job.bestZeros.load(std::memory_order_relaxed) + 1));
+        }
+        if (verbose && leased) {
+            std::cout << "[CPU] Mining batch (" << keccak.name << "): " << nonce
+                      << " difficulty: " << job.difficulty << std::endl;
+        }
+        std::uint64_t candidate = 0;
+        while (count && keccak.search(engine, mask, nonce, count, candidate)) {
+            const std::uint64_t hashed = candidate + 1 - nonce;
+            metrics.addHashes(worker, hashed);
+            job.hashes.fetch_add(hashed, std::memory_order_relaxed);
+            nonce += hashed;
+            count -= hashed;
+            engine.digest(candidate, digest.data());
+            if (job.best) {
+                const int zeros = zeroNibbles(digest.data());
+                if (zeros >= job.difficulty) {
+                    improve(job, digest.data(), candidate, zeros);
+                    mask = headMask(std::max(job.difficulty, job.bestZeros.load(std::memory_order_relaxed) + 1));
+                }
+                continue;
+            }
+            if (meets(digest.data())) {
+                bool expected = false;
+                if (job.solved.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                    TRACE_SPAN("publish", candidate);
+                    job.digest.assign(digest.begin(), digest.end());
+                    job.nonce = candidate;
+                    record(job);
+                    job.stop.store(true, std::memory_order_relaxed);
+                    metrics.observeFirstSolution(secondsSince(job.created));
+                    return true;
+                }
+                return false;
+            }
+        }
+        metrics.addHashes(worker, count);
+        job.hashes.fetch_add(count, std::memory_order_relaxed);
+        const double seconds = secondsSince(started);
+        metrics.observeBatch(worker, seconds);
+        if (job.tuner) {
+            job.tuner->observe(worker, chunk, seconds);
+            job.scheduler.resize(worker, job.tuner->size(worker));
+        }
+    }
+    return false;
+}
+
+// Restores the result recorded by a previous run, since its nonce range is already marked searched.
+inline void restoreResult(MiningJob& job) {
+    const std::int64_t zeros = job.resumed ? job.journal->zeros.load() : -1;
+    if (zeros < job.difficulty) {
+        return;
+    }
+    Digest digest;
+    const std::uint64_t nonce = job.journal->nonce.load();
+    job.engine.digest(nonce, digest.data());
+    if (!job.meets(digest.data())) {
+        return;
+    }
+    if (job.best) {
+        improve(job, digest.data(), nonce, zeroNibbles(digest.data()));
+    } else {
+        job.digest.assign(digest.begin(), digest.end());
+        job.nonce = nonce;
+        job.solved.store(true);
+        job.stop.store(true);
+    }
+}
+
+inline std::string toHex(const std::vector<std::uint8_t>& bytes) {
+    std::string hex;
+    char byte[3];
+    for (auto b : bytes) {
+        std::snprintf(byte, sizeof(byte), "%02x", b);
+        hex += byte;
+    }
+    return hex;
+}
@@ -0,0 +1,458 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Lock-free nonce distribution for a fixed pool of workers. Each worker owns a lease taken
+    from a shared atomic cursor and consumes it chunk by chunk; once the cursor reaches the end
+    of the range, idle workers steal the upper half of the largest remaining lease.
+    allocateWorkers() splits the pool across several farmers by deadline, and RateBalancer sizes
+    the ranges of devices that claim directly from the cursor (OpenCL devices) and, with
+    --auto-tune, the chunks of each worker. An optional
+    NonceJournal (kept in a memory-mapped checkpoint) makes the search resumable after a crash;
+    it also covers the ranges claimed by devices.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Crash-safe record of a search. Every nonce below `cursor` has been searched, except
+// [next, end) of each range with next < min(end, cursor). Ranges are written before the
+// cursor moves and progress only after hashing, so a torn update can only repeat work.
+struct NonceJournal {
+    static constexpr size_t capacity = 256;
+    struct Range {
+        std::atomic<std::uint64_t> next;
+        std::atomic<std::uint64_t> end;
+    };
+    std::atomic<std::uint64_t> cursor;
+    // Best result recorded by the caller (zeros < 0: none); nonce is written first.
+    std::atomic<std::int64_t> zeros;
+    std::atomic<std::uint64_t> nonce;
+    Range ranges[capacity];
+
+    // Lowest nonce that may not have been searched: the search has covered every nonce from its
+    // start up to here. Safe to call while workers update the journal (it can only lag behind).
+    std::uint64_t searched() const {
+        std::uint64_t lowest = cursor.load(std::memory_order_acquire);
+        for (const Range& range : ranges) {
+            const std::uint64_t next = range.next.load(std::memory_order_acquire);
+            if (next < std::min(range.end.load(std::memory_order_acquire), lowest)) {
+                lowest = next;
+            }
+        }
+        return lowest;
+    }
+};
+
+class NonceScheduler {
+    public:
+        // Searches [start, end) in chunks of `chunkSize` nonces, leasing `leaseSize` nonces at a time.
+        // With a journal, the search resumes from it: unfinished ranges are leased first, then
+        // the journal cursor continues (`start` is ignored).
+        NonceScheduler(size_t workers, std::uint64_t start, std::uint64_t end,
+            std::uint64_t leaseSize, std::uint64_t chunkSize, NonceJournal* journal = nullptr)
+            : slots(new Slot[workers]), workers(workers), cursor(start), end(end), chunk(chunkSize), leaseSize(leaseSize),
+              journal(journal) {
+            leaseChunks = chunksPerLease(chunkSize);
+            if (journal) {
+                resume();
+            }
+        }
+
+        // Claims the next chunk for `worker`. `leased` is set when a new lease was taken from the
+        // cursor. Returns false once the whole range has been handed out.
+        bool next(size_t worker, std::uint64_t& begin, std::uint64_t& count, bool& leased) {
+            leased = false;
+            Slot& slot = slots[worker];
+            if (journal && slot.hashed) {
+                // The chunk returned by the previous call has been hashed.
+                journal->ranges[slot.record].next.store(slot.hashed, std::memory_order_release);
+            }
+            while (true) {
+                std::uint64_t state = slot.state.load(std::memory_order_acquire);
+                std::uint64_t lo = offset(state, 0), hi = offset(state, 1);
+                if (lo < hi) {
+                    std::uint64_t base = slot.base.load(std::memory_order_relaxed);
+                    std::uint64_t step = slot.chunk.load(std::memory_order_relaxed);
+                    if (slot.state.compare_exchange_weak(state, pack(generation(state), lo + 1, hi),
+                        std::memory_order_acq_rel)) {
+                        begin = base + lo * step;
+                        count = std::min(step, slot.limit.load(std::memory_order_relaxed) - begin);
+                        slot.hashed = begin + count;
+                        return true;
+                    }
+                    continue;
+                }
+                if (lease(slot)) {
+                    leased = true;
+                } else if (!steal(worker)) {
+                    return false;
+                }
+            }
+        }
+
+        // Journal ranges for a device that keeps up to `inFlight` claims in flight (see claim());
+        // empty without a journal. Called before the device starts.
+        std::vector<size_t> reserve(size_t inFlight) {
+            std::vector<size_t> records;
+            if (journal) {
+                if (spare.size() < inFlight) {
+                    throw std::invalid_argument("Too many devices for the checkpoint journal.");
+                }
+                records.assign(spare.end() - inFlight, spare.end());
+                spare.resize(spare.size() - inFlight);
+            }
+            return records;
+        }
+
+        // Takes up to `size` nonces straight from the shared cursor, for devices that size their
+        // own ranges (see RateBalancer). With a journal, unfinished ranges of a previous run are
+        // handed out first, and each range is journaled in a free entry of the device's `records`
+        // (see reserve()) until complete() reports it; with no free entry nothing is claimed.
+        // Returns false once the whole range has been handed out.
+        bool claim(std::uint64_t size, std::uint64_t& begin, std::uint64_t& count, const std::vector<size_t>& records = {}) {
+            size_t free = 0;
+            if (journal) {
+                free = NonceJournal::capacity;
+                for (size_t i : records) {
+                    if (journal->ranges[i].next.load(std::memory_order_relaxed) >= journal->ranges[i].end.load(std::memory_order_relaxed)) {
+                        free = i;
+                        break;
+                    }
+                }
+                std::uint64_t limit = 0;
+                if (free == NonceJournal::capacity) {
+                    return false;
+                } else if (resumeRange(free, begin, limit)) {
+                    count = limit - begin;
+                    return true;
+                }
+            }
+            std::atomic<std::uint64_t>& shared = journal ? journal->cursor : cursor;
+            begin = shared.load(std::memory_order_relaxed);
+            do {
+                if (begin >= end) {
+                    return false;
+                }
+                count = std::min(size, end - begin);
+                if (journal) {
+                    journal->ranges[free].next.store(begin, std::memory_order_release);
+                    journal->ranges[free].end.store(begin + count, std::memory_order_release);
+                }
+            } while (!shared.compare_exchange_weak(begin, begin + count, std::memory_order_acq_rel));
+            return true;
+        }
+
+        // Records that the range [begin, begin + count) claimed with `records` has been searched.
+        void complete(const std::vector<size_t>& records, std::uint64_t begin, std::uint64_t count) {
+            for (size_t i : records) {
+                NonceJournal::Range& range = journal->ranges[i];
+                if (range.next.load(std::memory_order_relaxed) == begin && begin < range.end.load(std::memory_order_relaxed)) {
+                    range.next.store(begin + count, std::memory_order_release);
+                    return;
+                }
+            }
+        }
+
+        // Owner-only: chunk size of `worker` from its next lease on (0: the scheduler's chunk size).
+        void resize(size_t worker, std::uint64_t size) {
+            slots[worker].wanted = size;
+        }
+
+    private:
+        // Packed lease state: generation (24 bits), next chunk (20 bits), end chunk (20 bits).
+        // The generation changes on every refill so a thief never commits against a recycled lease.
+        static constexpr std::uint64_t offsetMask = (1ULL << 20) - 1;
+
+        struct alignas(64) Slot {
+            std::atomic<std::uint64_t> state{0};
+            std::atomic<std::uint64_t> base{0};
+            std::atomic<std::uint64_t> limit{0};
+            // Chunk size of the current lease, written with base and limit.
+            std::atomic<std::uint64_t> chunk{0};
+            // Journal range of this worker, fixed at construction (thieves trim its end).
+            size_t record = 0;
+            // Owner-only: end of its last returned chunk and requested chunk size (see resize()).
+            std::uint64_t hashed = 0;
+            std::uint64_t wanted = 0;
+        };
+
+        struct Pending {
+            size_t record;
+            std::uint64_t begin, end;
+        };
+
+        static std::uint64_t pack(std::uint64_t gen, std::uint64_t lo, std::uint64_t hi) {
+            return (gen << 40) | (lo << 20) | hi;
+        }
+        static std::uint64_t generation(std::uint64_t state) { return state >> 40; }
+        static std::uint64_t offset(std::uint64_t state, int index) {
+            return (state >> (index ? 0 : 20)) & offsetMask;
+        }
+
+        std::uint64_t chunksPerLease(std::uint64_t step) const {
+            return std::max<std::uint64_t>(1, std::min<std::uint64_t>(leaseSize / step, offsetMask));
+        }
+
+        // Refills an empty slot from the shared cursor. Only the owner writes base/limit, and only
+        // while its lease is empty, so thieves (which require a non-empty lease) never see them change.
+        bool lease(Slot& slot) {
+            std::uint64_t begin = 0, limit = 0;
+            if (journal && resumeRange(slot.record, begin, limit)) {
+                slot.hashed = 0;
+                publish(slot, begin, limit, chunk);
+                return true;
+            }
+            std::atomic<std::uint64_t>& shared = journal ? journal->cursor : cursor;
+            begin = shared.load(std::memory_order_relaxed);
+            std::uint64_t size = 0;
+            const std::uint64_t step = slot.wanted ? slot.wanted : chunk;
+            const std::uint64_t chunks = slot.wanted ? chunksPerLease(step) : leaseChunks;
+            do {
+                if (begin >= end) {
+                    return false;
+                }
+                size = std::min(chunks * step, end - begin);
+                record(slot, begin, begin + size);
+            } while (!shared.compare_exchange_weak(begin, begin + size, std::memory_order_acq_rel));
+            publish(slot, begin, begin + size, step);
+            return true;
+        }
+
+        // Takes the next range left unfinished by a previous run and journals it in `record`. The
+        // lock keeps the pieces of a split range journaled in order; it is only taken while such
+        // ranges remain.
+        bool resumeRange(size_t record, std::uint64_t& begin, std::uint64_t& limit) {
+            if (pendingNext.load(std::memory_order_relaxed) >= pending.size()) {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            const size_t index = pendingNext.load(std::memory_order_relaxed);
+            if (index >= pending.size()) {
+                return false;
+            }
+            pendingNext.store(index + 1, std::memory_order_relaxed);
+            const Pending& range = pending[index];
+            journal->ranges[record].next.store(range.begin, std::memory_order_release);
+            journal->ranges[record].end.store(range.end, std::memory_order_release);
+            journal->ranges[range.record].next.store(range.end, std::memory_order_release);
+            begin = range.begin;
+            limit = range.end;
+            return true;
+        }
+
+        // Journals [begin, end) as unfinished for the slot's worker before it is claimed.
+        void record(Slot& slot, std::uint64_t begin, std::uint64_t end) {
+            if (journal) {
+                slot.hashed = 0;
+                journal->ranges[slot.record].next.store(begin, std::memory_order_release);
+                journal->ranges[slot.record].end.store(end, std::memory_order_release);
+            }
+        }
+
+        // Collects the unfinished ranges of the journal and gives each worker a free range record;
+        // the other free records are cleared and kept for reserve().
+        void resume() {
+            const std::uint64_t limit = journal->cursor.load();
+            size_t free = 0;
+            for (size_t i = 0; i < NonceJournal::capacity; ++i) {
+                const std::uint64_t next = journal->ranges[i].next.load();
+                const std::uint64_t stop = std::min(journal->ranges[i].end.load(), limit);
+                if (next < stop) {
+                    for (std::uint64_t begin = next; begin < stop; begin += leaseChunks * chunk) {
+                        pending.push_back({i, begin, std::min(stop, begin + leaseChunks * chunk)});
+                    }
+                } else if (free < workers) {
+                    slots[free++].record = i;
+                } else {
+                    journal->ranges[i].next.store(0);
+                    journal->ranges[i].end.store(0);
+                    spare.push_back(i);
+                }
+            }
+            if (free < workers) {
+                throw std::invalid_argument("Too many workers for the checkpoint journal.");
+            }
+        }
+
+        void publish(Slot& slot, std::uint64_t begin, std::uint64_t limit, std::uint64_t step) {
+            const std::uint64_t state = slot.state.load(std::memory_order_relaxed);
+            slot.base.store(begin, std::memory_order_relaxed);
+            slot.limit.store(limit, std::memory_order_relaxed);
+            slot.chunk.store(step, std::memory_order_relaxed);
+            slot.state.store(pack(generation(state) + 1, 0, (limit - begin + step - 1) / step),
+                std::memory_order_release);
+        }
+
+        // Moves the upper half of the largest remaining lease into the worker's own slot. The
+        // victim keeps whole chunks below the split, so its limit only matters for the stolen tail.
+        // Its journaled end is cut to the split unless it has already journaled another range (the
+        // end read before the split then no longer matches). The cut comes before the stolen range
+        // is published, so the victim cannot steal it back and journal the same end in between.
+        bool steal(size_t worker) {
+            while (true) {
+                size_t victim = workers;
+                std::uint64_t largest = 1;
+                for (size_t i = 0; i < workers; ++i) {
+                    std::uint64_t state = slots[i].state.load(std::memory_order_acquire);
+                    std::uint64_t remaining = offset(state, 1) - offset(state, 0);
+                    if (i != worker && remaining > largest) {
+                        largest = remaining;
+                        victim = i;
+                    }
+                }
+                if (victim == workers) {
+                    return false;
+                }
+                Slot& slot = slots[victim];
+                std::uint64_t state = slot.state.load(std::memory_order_acquire);
+                std::uint64_t lo = offset(state, 0), hi = offset(state, 1);
+                if (hi <= lo + 1) {
+                    continue;
+                }
+                const std::uint64_t base = slot.base.load(std::memory_order_relaxed);
+                const std::uint64_t limit = slot.limit.load(std::memory_order_relaxed);
+                const std::uint64_t step = slot.chunk.load(std::memory_order_relaxed);
+                const std::uint64_t mid = lo + (hi - lo) / 2;
+                std::uint64_t journaled = journal ? journal->ranges[slot.record].end.load(std::memory_order_acquire) : 0;
+                record(slots[worker], base + mid * step, std::min(limit, base + hi * step));
+                if (slot.state.compare_exchange_strong(state, pack(generation(state), lo, mid),
+                    std::memory_order_acq_rel)) {
+                    if (journal) {
+                        journal->ranges[slot.record].end.compare_exchange_strong(journaled, base + mid * step,
+                            std::memory_order_acq_rel);
+                    }
+                    publish(slots[worker], base + mid * step, std::min(limit, base + hi * step), step);
+                    return true;
+                }
+            }
+        }
+
+        std::unique_ptr<Slot[]> slots;
+        const size_t workers;
+        std::atomic<std::uint64_t> cursor;
+        const std::uint64_t end;
+        const std::uint64_t chunk;
+        const std::uint64_t leaseSize;
+        std::uint64_t leaseChunks;
+        NonceJournal* journal;
+        std::vector<Pending> pending;
+        std::vector<size_t> spare;
+        std::atomic<size_t> pendingNext{0};
+        std::mutex pendingMutex;
+};
+
+// Range sizes for devices of different speeds sharing one nonce cursor. Each device's next
+// range is its measured rate (moving average) times `target` seconds, so ranges are handed out
+// in proportion to rate, follow rate changes, and a stop is seen within about one batch.
+// With --auto-tune the CPU workers are sized the same way, one entry per worker.
+class RateBalancer {
+    public:
+        RateBalancer(size_t devices, std::uint64_t initial, double target, std::uint64_t granularity)
+            : rates(new Rate[devices]), initial(initial), target(target), granularity(std::max<std::uint64_t>(1, granularity)) {}
+
+        std::uint64_t size(size_t device) const {
+            const double rate = rates[device].value.load(std::memory_order_relaxed);
+            if (rate <= 0) {
+                return initial;
+            }
+            const double range = std::min(std::max(rate * target, static_cast<double>(granularity)), maxRange);
+            return (static_cast<std::uint64_t>(range) + granularity - 1) / granularity * granularity;
+        }
+
+        // Owner-only: called by the device's thread after each batch.
+        void observe(size_t device, std::uint64_t hashes, double seconds) {
+            if (seconds <= 0) {
+                return;
+            }
+            std::atomic<double>& rate = rates[device].value;
+            const double sample = hashes / seconds, previous = rate.load(std::memory_order_relaxed);
+            rate.store(previous > 0 ? previous + smoothing * (sample - previous) : sample, std::memory_order_relaxed);
+        }
+
+        double rate(size_t device) const { return rates[device].value.load(std::memory_order_relaxed); }
+
+        // Starts `device` from a known rate (e.g. a saved tune profile) instead of `initial`.
+        void seed(size_t device, double rate) { rates[device].value.store(rate, std::memory_order_relaxed); }
+
+    private:
+        static constexpr double smoothing = 0.3;
+        static constexpr double maxRange = 1ULL << 36;
+
+        struct alignas(64) Rate {
+            std::atomic<double> value{0};
+        };
+
+        std::unique_ptr<Rate[]> rates;
+        const std::uint64_t initial;
+        const double target;
+        const std::uint64_t granularity;
+};
+
+// Largest-remainder split of `total` in proportion to `weights`.
+inline std::vector<size_t> apportion(const std::vector<double>& weights, size_t total) {
+    std::vector<size_t> shares(weights.size(), 0);
+    double sum = 0;
+    for (double w : weights) {
+        sum += std::max(0.0, w);
+    }
+    if (sum <= 0 || total == 0) {
+        return shares;
+    }
+    std::vector<std::pair<double, size_t>> remainders;
+    size_t given = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        double exact = std::max(0.0, weights[i]) * total / sum;
+        shares[i] = static_cast<size_t>(exact);
+        given += shares[i];
+        remainders.push_back({exact - shares[i], i});
+    }
+    std::sort(remainders.begin(), remainders.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = 0; given < total && i < remainders.size(); ++i, ++given) {
+        shares[remainders[i].second]++;
+    }
+    return shares;
+}
+
+// Splits `workers` across farmers. `need[i]` is the hash rate farmer i needs to expect a solution
+// before its deadline, `perWorker` the measured rate of one worker and `order` the farmers by
+// deadline. Each farmer first gets one worker (earliest deadline first), then the workers it
+// needs (shared in proportion when short), and any surplus goes in proportion to need.
+inline std::vector<size_t> allocateWorkers(const std::vector<double>& need, const std::vector<size_t>& order,
+    double perWorker, size_t workers) {
+    std::vector<size_t> shares(need.size(), 0);
+    size_t left = workers;
+    for (size_t i : order) {
+        if (left) {
+            shares[i]++;
+            left--;
+        }
+    }
+    std::vector<double> want(need.size(), 0);
+    double wanted = 0;
+    for (size_t i = 0; i < need.size(); ++i) {
+        want[i] = std::max(0.0, std::ceil(need[i] / perWorker) - shares[i]);
+        wanted += want[i];
+    }
+    std::vector<size_t> extra = wanted <= left ? std::vector<size_t>(want.begin(), want.end()) : apportion(want, left);
+    for (size_t i = 0; i < need.size(); ++i) {
+        shares[i] += extra[i];
+        left -= extra[i];
+    }
+    extra = apportion(need, left);
+    for (size_t i = 0; i < need.size(); ++i) {
+        shares[i] += extra[i];
+    }
+    return shares;
+}
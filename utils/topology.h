@@ -0,0 +1,137 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    CPU topology (Linux sysfs) and worker pinning. Placement spreads workers over NUMA nodes
+    and physical cores first; SMT siblings are only used in logical mode.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct CpuInfo {
+    int cpu;
+    int core;
+    int package;
+    int node;
+};
+
+enum class Affinity { None, Core, Logical };
+
+// Parses a sysfs cpu list such as "0-3,8,10-11".
+inline std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || !std::isdigit(static_cast<unsigned char>(range[0]))) {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+inline int readSysInt(const std::string& path, int fallback) {
+    std::ifstream file(path);
+    int value = fallback;
+    return (file >> value) ? value : fallback;
+}
+
+// Online CPUs usable by this process, with their physical core, package and NUMA node.
+inline std::vector<CpuInfo> readTopology() {
+    std::vector<CpuInfo> topology;
+#if defined(__linux__)
+    const std::string root = "/sys/devices/system/cpu/";
+    std::ifstream online(root + "online");
+    std::string list;
+    std::getline(online, list);
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool masked = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    for (int cpu : parseCpuList(list)) {
+        if (masked && !CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        const std::string dir = root + "cpu" + std::to_string(cpu) + "/";
+        CpuInfo info{cpu, readSysInt(dir + "topology/core_id", cpu),
+            readSysInt(dir + "topology/physical_package_id", 0), 0};
+        if (DIR* entries = opendir(dir.c_str())) {
+            while (dirent* entry = readdir(entries)) {
+                if (std::strncmp(entry->d_name, "node", 4) == 0 && std::isdigit(static_cast<unsigned char>(entry->d_name[4]))) {
+                    info.node = std::atoi(entry->d_name + 4);
+                }
+            }
+            closedir(entries);
+        }
+        topology.push_back(info);
+    }
+#endif
+    return topology;
+}
+
+// Pinning order: one CPU per physical core, interleaved across NUMA nodes; in logical mode the
+// remaining SMT siblings follow in the same order.
+inline std::vector<CpuInfo> placeWorkers(const std::vector<CpuInfo>& topology, Affinity mode) {
+    std::map<std::pair<int, int>, int> rank;
+    std::map<int, std::vector<std::vector<CpuInfo>>> nodes;
+    for (const auto& info : topology) {
+        int sibling = rank[{info.package, info.core}]++;
+        auto& tiers = nodes[info.node];
+        if (static_cast<int>(tiers.size()) <= sibling) {
+            tiers.resize(sibling + 1);
+        }
+        tiers[sibling].push_back(info);
+    }
+    std::vector<CpuInfo> placement;
+    const size_t tiers = mode == Affinity::Logical ? topology.size() : 1;
+    for (size_t tier = 0; tier < tiers; ++tier) {
+        for (size_t i = 0, added = 1; added; ++i) {
+            added = 0;
+            for (auto& node : nodes) {
+                if (tier < node.second.size() && i < node.second[tier].size()) {
+                    placement.push_back(node.second[tier][i]);
+                    added++;
+                }
+            }
+        }
+    }
+    return placement;
+}
+
+// Pins the calling thread to `cpu`; returns false where unsupported.
+inline bool pinThread(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
@@ -0,0 +1,163 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Hot-path tracing, compiled in with TRACE=1 (make TRACE=1). Each thread records fixed-size
+    spans into its own ring buffer (newest records win) with no locks after registration;
+    writeTrace() dumps them as Chrome/Perfetto trace-event JSON. Without TRACE the macros
+    expand to nothing.
+*/
+
+#pragma once
+
+#if defined(TRACE) && TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceRecord {
+    const char* name;
+    std::uint64_t start;
+    std::uint64_t end;
+    std::uint64_t arg;
+};
+
+struct TraceBuffer {
+    static constexpr size_t capacity = 1 << 16;
+    explicit TraceBuffer(size_t tid) : tid(tid), records(new TraceRecord[capacity]) {}
+    const size_t tid;
+    std::string name;
+    std::unique_ptr<TraceRecord[]> records;
+    std::atomic<std::uint64_t> head{0};
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+inline TraceRegistry& traceRegistry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+inline std::uint64_t traceNow() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - traceRegistry().epoch).count());
+}
+
+// The calling thread's buffer, registered on first use.
+inline TraceBuffer& traceBuffer() {
+    thread_local TraceBuffer* buffer = nullptr;
+    if (!buffer) {
+        TraceRegistry& registry = traceRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.buffers.emplace_back(new TraceBuffer(registry.buffers.size() + 1));
+        buffer = registry.buffers.back().get();
+    }
+    return *buffer;
+}
+
+inline void traceRecord(const char* name, std::uint64_t start, std::uint64_t end, std::uint64_t arg) {
+    TraceBuffer& buffer = traceBuffer();
+    const std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.records[head % TraceBuffer::capacity] = {name, start, end, arg};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+// Names the calling thread in the trace.
+inline void traceThreadName(const std::string& name) {
+    TraceBuffer& buffer = traceBuffer();
+    std::lock_guard<std::mutex> lock(traceRegistry().mutex);
+    buffer.name = name;
+}
+
+class TraceSpan {
+    public:
+        explicit TraceSpan(const char* name, std::uint64_t arg = 0) : name(name), arg(arg), start(traceNow()) {}
+        ~TraceSpan() { traceRecord(name, start, traceNow(), arg); }
+
+        // Ends this span and starts the next step of the same scope.
+        void next(const char* nextName, std::uint64_t nextArg = 0) {
+            const std::uint64_t now = traceNow();
+            traceRecord(name, start, now, arg);
+            name = nextName;
+            arg = nextArg;
+            start = now;
+        }
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+    private:
+        const char* name;
+        std::uint64_t arg;
+        std::uint64_t start;
+};
+
+// Writes every buffered span. Call once the traced threads are idle or joined, since a record
+// being overwritten while it is copied would come out torn.
+inline bool writeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    TraceRegistry& registry = traceRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& buffer : registry.buffers) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+            << ",\"args\":{\"name\":\"" << (buffer->name.empty() ? "thread " + std::to_string(buffer->tid) : buffer->name) << "\"}}";
+        first = false;
+        const std::uint64_t head = buffer->head.load(std::memory_order_acquire);
+        const std::uint64_t begin = head > TraceBuffer::capacity ? head - TraceBuffer::capacity : 0;
+        for (std::uint64_t i = begin; i < head; ++i) {
+            const TraceRecord& record = buffer->records[i % TraceBuffer::capacity];
+            out << ",\n{\"name\":\"" << record.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"ts\":" << record.start / 1000 << "." << (record.start % 1000) / 100
+                << ",\"dur\":" << (record.end - record.start) / 1000 << "." << ((record.end - record.start) % 1000) / 100
+                << ",\"args\":{\"arg\":" << record.arg << "}}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    return static_cast<bool>(out);
+}
+
+// Dumps the trace to `path` (if set) when it goes out of scope.
+struct TraceOutput {
+    std::string path;
+    ~TraceOutput() {
+        if (!path.empty() && !writeTrace(path)) {
+            std::cerr << "Failed to write trace " << path << "\n";
+        }
+    }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Records the enclosing scope as a span; the optional second argument is an integer tag.
+#define TRACE_SPAN(...) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(__VA_ARGS__)
+// Sequential steps of one scope: TRACE_STEPS opens the first, TRACE_NEXT moves to the next.
+#define TRACE_STEPS(var, ...) TraceSpan var(__VA_ARGS__)
+#define TRACE_NEXT(var, ...) var.next(__VA_ARGS__)
+#define TRACE_THREAD(name) traceThreadName(name)
+
+#else
+
+#define TRACE_SPAN(...) do {} while (0)
+#define TRACE_STEPS(var, ...) do {} while (0)
+#define TRACE_NEXT(var, ...) do {} while (0)
+#define TRACE_THREAD(name) do {} while (0)
+
+#endif
@@ -0,0 +1,174 @@
+/*
+    MIT License
+    Author: Fred Kyung-jin Rezeau <fred@litemint.com>, 2025
+    Permission is granted to use, copy, modify, and distribute this software for any purpose
+    with or without fee.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND.
+
+    Auto-tuning (--auto-tune). Batch sizes follow the measured rate online (RateBalancer in
+    scheduler.h); WorkGroupTuner picks the GPU work-group size by measuring each candidate on
+    live batches, and TuneProfile keeps the tuned values per host and device between runs.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+// Host name keying the tune profile entries.
+inline std::string hostName() {
+#if defined(_WIN32)
+    const char* name = std::getenv("COMPUTERNAME");
+    return name ? name : "localhost";
+#else
+    char name[256] = {};
+    return gethostname(name, sizeof(name) - 1) == 0 && name[0] ? name : "localhost";
+#endif
+}
+
+// Next to the OpenCL program cache: $KALE_MINER_CACHE, else the user cache directory.
+inline std::filesystem::path tuneProfilePath() {
+    std::filesystem::path dir;
+    if (const char* env = std::getenv("KALE_MINER_CACHE")) {
+        dir = env;
+    } else {
+#if defined(_WIN32)
+        if (const char* env = std::getenv("LOCALAPPDATA")) {
+            dir = std::filesystem::path(env) / "kale-miner";
+        }
+#else
+        if (const char* env = std::getenv("XDG_CACHE_HOME")) {
+            dir = std::filesystem::path(env) / "kale-miner";
+        } else if (const char* env = std::getenv("HOME")) {
+            dir = std::filesystem::path(env) / ".cache" / "kale-miner";
+        }
+#endif
+    }
+    return dir.empty() ? std::filesystem::path("kale-miner.tune") : dir / "tune.txt";
+}
+
+// Tuned values of one device: batch (GPU) or chunk (CPU worker) size, work-group size
+// (0: not applicable) and the measured rate per device or worker.
+struct TuneEntry {
+    std::uint64_t size = 0;
+    int localSize = 0;
+    double rate = 0;
+};
+
+// Text profile, one "<host>/<device>\t<size>\t<local size>\t<rate>" line per entry. A
+// missing or unreadable file is an empty profile; saving replaces it atomically.
+class TuneProfile {
+    public:
+        explicit TuneProfile(std::filesystem::path file) : file(std::move(file)) {
+            std::ifstream in(this->file);
+            std::string line;
+            while (std::getline(in, line)) {
+                std::stringstream ss(line);
+                std::string key, size, localSize, rate;
+                if (std::getline(ss, key, '\t') && std::getline(ss, size, '\t') && std::getline(ss, localSize, '\t')
+                    && std::getline(ss, rate)) {
+                    try {
+                        entries[key] = {std::stoull(size), std::stoi(localSize), std::stod(rate)};
+                    } catch (const std::exception&) {
+                    }
+                }
+            }
+        }
+
+        bool lookup(const std::string& key, TuneEntry& entry) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it == entries.end() || it->second.size == 0 || it->second.rate <= 0) {
+                return false;
+            }
+            entry = it->second;
+            return true;
+        }
+
+        void update(const std::string& key, const TuneEntry& entry) {
+            std::lock_guard<std::mutex> lock(mutex);
+            entries[key] = entry;
+        }
+
+        bool save() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::error_code error;
+            if (file.has_parent_path()) {
+                std::filesystem::create_directories(file.parent_path(), error);
+            }
+            const std::filesystem::path temp = file.string() + ".tmp";
+            {
+                std::ofstream out(temp, std::ios::trunc);
+                for (const auto& [key, entry] : entries) {
+                    out << key << '\t' << entry.size << '\t' << entry.localSize << '\t' << entry.rate << '\n';
+                }
+                if (!out) {
+                    return false;
+                }
+            }
+            std::filesystem::rename(temp, file, error);
+            return !error;
+        }
+
+        const std::filesystem::path& path() const { return file; }
+
+    private:
+        const std::filesystem::path file;
+        std::map<std::string, TuneEntry> entries;
+        mutable std::mutex mutex;
+};
+
+// Measures the work-group sizes from 32 up to `limit` (powers of two) for `samples` batches
+// each and keeps the fastest. The caller runs its batches with current() until done().
+class WorkGroupTuner {
+    public:
+        explicit WorkGroupTuner(int limit, int samples = 3) : samples(std::max(1, samples)) {
+            for (int size = std::min(32, std::max(1, limit)); size <= std::max(1, limit); size *= 2) {
+                candidates.push_back(size);
+            }
+            rates.assign(candidates.size(), 0);
+        }
+
+        bool done() const { return index >= candidates.size(); }
+        int current() const { return done() ? best() : candidates[index]; }
+
+        int best() const {
+            return candidates[std::max_element(rates.begin(), rates.end()) - rates.begin()];
+        }
+
+        // Records one batch run with current().
+        void observe(std::uint64_t hashes, double seconds) {
+            if (done() || seconds <= 0) {
+                return;
+            }
+            hashed += hashes;
+            elapsed += seconds;
+            if (++observed == samples) {
+                rates[index++] = hashed / elapsed;
+                hashed = 0;
+                elapsed = 0;
+                observed = 0;
+            }
+        }
+
+    private:
+        const int samples;
+        std::vector<int> candidates;
+        std::vector<double> rates;
+        size_t index = 0;
+        int observed = 0;
+        double hashed = 0;
+        double elapsed = 0;
+};